@@ -0,0 +1,154 @@
+/// @file Monotonic (bump) arena and container allocator adaptor
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstddef>
+
+#include "common.h"
+#include "memory.h"
+
+namespace rtl {
+
+///
+/// Chunked bump allocator. Memory is handed out linearly from pool chunks
+/// and only given back all at once by reset() or the destructor.
+///
+class arena {
+   public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+    explicit arena(size_t chunk_size = kDefaultChunkSize, PoolTag tag = PoolTag::NonPaged)
+        : chunk_size_(chunk_size), tag_(tag) { ; }
+
+    ~arena() { release(); }
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    /// @return n bytes aligned to align (a power of 2), nullptr if the pool is exhausted
+    void* allocate(size_t n, size_t align = alignof(max_align_t)) {
+        char* p = align_up(ptr_, align);
+        if (head_ == nullptr || p + n > end_) {
+            if (!grow(n + align)) {
+                return nullptr;
+            }
+            p = align_up(ptr_, align);
+        }
+        ptr_ = p + n;
+        return p;
+    }
+
+    /// @brief drop every allocation, keeping the most recent chunk for reuse
+    void reset() {
+        if (head_) {
+            release(head_->next);
+            head_->next = nullptr;
+            ptr_ = reinterpret_cast<char*>(head_ + 1);
+        }
+    }
+
+    /// @brief drop every allocation and return all chunks to the pool
+    void release() {
+        release(head_);
+        head_ = nullptr;
+        ptr_ = nullptr;
+        end_ = nullptr;
+    }
+
+    _NODISCARD PoolTag tag() const {
+        return tag_;
+    }
+
+   private:
+    struct chunk {
+        chunk* next;
+    };
+
+    static char* align_up(char* p, size_t align) {
+        return reinterpret_cast<char*>((reinterpret_cast<size_t>(p) + align - 1) & ~(align - 1));
+    }
+
+    bool grow(size_t n) {
+        size_t size = sizeof(chunk) + (n > chunk_size_ ? n : chunk_size_);
+        chunk* c = static_cast<chunk*>(::operator new(size, tag_));
+        if (c == nullptr) {
+            return false;
+        }
+        c->next = head_;
+        head_ = c;
+        ptr_ = reinterpret_cast<char*>(c + 1);
+        end_ = reinterpret_cast<char*>(c) + size;
+        return true;
+    }
+
+    void release(chunk* c) {
+        while (c) {
+            chunk* next = c->next;
+            ::operator delete(c, tag_);
+            c = next;
+        }
+    }
+
+   private:
+    size_t chunk_size_;
+    PoolTag tag_;
+    chunk* head_ = nullptr;
+    char* ptr_ = nullptr;
+    char* end_ = nullptr;
+};
+
+///
+/// Allocator adaptor drawing from an arena. deallocate() is a no-op, so
+/// containers of trivially destructible elements tear down in O(1) and may
+/// even be destroyed after the arena was reset.
+///
+template <typename T>
+class arena_allocator {
+   public:
+    using value_type = T;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+
+    template <typename U>
+    struct rebind {
+        using other = arena_allocator<U>;
+    };
+
+    arena_allocator(arena& a) : arena_(&a) { ; }
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : arena_(other.arena_) { ; }
+
+    T* allocate(size_t n) const {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) const { ; }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const {
+        return arena_ == other.arena_;
+    }
+
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const {
+        return arena_ != other.arena_;
+    }
+
+   private:
+    template <typename U>
+    friend class arena_allocator;
+
+    arena* arena_;
+};
+
+template <typename T>
+struct is_monotonic_allocator<arena_allocator<T>> : true_type {};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+/// @file helpers for the user-mode benchmarks, build each one from the
+/// repository root with
+///   g++ -std=c++17 -O2 -pthread -iquote . bench/<name>.cc *.cc -o <name>
+#ifndef _RTL_BENCH_H
+#define _RTL_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+namespace bench {
+
+inline double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief xorshift64*, deterministic input generation
+struct random {
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dull;
+    }
+};
+
+/// @brief keep the optimizer from dropping a computed value
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace bench
+
+#endif
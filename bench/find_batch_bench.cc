@@ -0,0 +1,69 @@
+/// @file lookups per second of find_batch against a loop of find, for
+/// unordered_map and flat_hash_map from cache-resident to DRAM-bound sizes
+#include <vector>
+
+#include "bench/bench.h"
+#include "flat_hash_map.h"
+#include "slab.h"
+#include "unordered_map.h"
+
+namespace {
+
+constexpr size_t kBatchKeys = 32;           // keys per find_batch call
+constexpr size_t kLookups = 4 * 1000 * 1000;  // per measurement
+
+template <class Map>
+void run(const char* name, size_t size) {
+    Map map;
+    bench::random rnd;
+    std::vector<uint64_t> keys(size);
+    for (size_t i = 0; i < size; i++) {
+        keys[i] = rnd.next();
+        map[keys[i]] = i;
+    }
+
+    std::vector<uint64_t> queries(kLookups);
+    for (auto& q : queries) {
+        q = keys[rnd.next() % size];
+    }
+
+    double start = bench::now_seconds();
+    size_t sum = 0;
+    for (size_t i = 0; i < kLookups; i++) {
+        sum += map.find(queries[i])->second;
+    }
+    double single = bench::now_seconds() - start;
+    bench::keep(sum);
+
+    start = bench::now_seconds();
+    size_t batch_sum = 0;
+    typename Map::iterator out[kBatchKeys];
+    for (size_t i = 0; i < kLookups; i += kBatchKeys) {
+        map.find_batch(&queries[i], kBatchKeys, out);
+        for (size_t j = 0; j < kBatchKeys; j++) {
+            batch_sum += out[j]->second;
+        }
+    }
+    double batch = bench::now_seconds() - start;
+    bench::keep(batch_sum);
+    if (sum != batch_sum) {
+        printf("mismatch\n");
+    }
+
+    printf("%-14s %10zu %12.1f %12.1f %8.2fx\n", name, size, kLookups / single / 1e6, kLookups / batch / 1e6,
+           single / batch);
+}
+
+}  // namespace
+
+int main() {
+    static_assert(kLookups % kBatchKeys == 0, "whole batches");
+    rtl::slab_initialize();
+    printf("%-14s %10s %12s %12s %9s   (M lookups per second)\n", "map", "size", "find", "find_batch", "gain");
+    for (size_t size = 1024; size <= 4 * 1024 * 1024; size *= 8) {
+        run<rtl::unordered_map<uint64_t, uint64_t>>("unordered_map", size);
+        run<rtl::flat_hash_map<uint64_t, uint64_t>>("flat_hash_map", size);
+    }
+    rtl::slab_uninitialize();
+    return 0;
+}
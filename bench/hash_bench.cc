@@ -0,0 +1,89 @@
+/// @file throughput of the word-at-a-time hashes against byte-wise FNV-1a
+#include <vector>
+
+#include "bench/bench.h"
+#include "hash.h"
+
+namespace {
+
+constexpr size_t kBytes = 256 * 1024 * 1024;  // hashed per measurement
+constexpr size_t kBuffer = 64 * 1024;         // cache resident input
+
+struct fnv1a {
+    size_t operator()(const unsigned char* p, size_t n) const {
+        return rtl::_Fnv1a_append_bytes(rtl::_FNV_offset_basis, p, n);
+    }
+};
+
+struct word_hash {
+    size_t operator()(const unsigned char* p, size_t n) const {
+        return rtl::_Hash_result(rtl::_Hash_bytes(p, n));
+    }
+};
+
+struct crc32c_hash {
+    size_t operator()(const unsigned char* p, size_t n) const {
+        return rtl::crc32c(p, n);
+    }
+};
+
+/// @return GB per second hashing len-byte keys laid out back to back
+template <class Hash>
+double bytes_rate(const std::vector<unsigned char>& buffer, size_t len) {
+    size_t keys = kBuffer / len;
+    size_t rounds = kBytes / (keys * len);
+    size_t sum = 0;
+    double start = bench::now_seconds();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t k = 0; k < keys; k++) {
+            sum += Hash()(&buffer[k * len], len);
+        }
+    }
+    double elapsed = bench::now_seconds() - start;
+    bench::keep(sum);
+    return rounds * keys * len / elapsed / 1e9;
+}
+
+/// @return M integer keys per second
+template <class Hash>
+double integer_rate(const std::vector<uint64_t>& values) {
+    constexpr size_t kRounds = 64;
+    size_t sum = 0;
+    double start = bench::now_seconds();
+    for (size_t r = 0; r < kRounds; r++) {
+        for (uint64_t v : values) {
+            sum += Hash()(v);
+        }
+    }
+    double elapsed = bench::now_seconds() - start;
+    bench::keep(sum);
+    return kRounds * values.size() / elapsed / 1e6;
+}
+
+}  // namespace
+
+int main() {
+    bench::random rnd;
+    std::vector<unsigned char> buffer(kBuffer);
+    for (auto& b : buffer) {
+        b = static_cast<unsigned char>(rnd.next());
+    }
+
+    printf("%-8s %10s %10s %10s   (GB per second)\n", "bytes", "fnv1a", "rtl::hash", "crc32c");
+    const size_t lengths[] = {4, 8, 16, 24, 32, 64, 256, 4096};
+    for (size_t len : lengths) {
+        printf("%-8zu %10.2f %10.2f %10.2f\n", len, bytes_rate<fnv1a>(buffer, len), bytes_rate<word_hash>(buffer, len),
+               bytes_rate<crc32c_hash>(buffer, len));
+    }
+
+    std::vector<uint64_t> values(kBuffer / sizeof(uint64_t));
+    for (auto& v : values) {
+        v = rnd.next();
+    }
+    struct fnv1a_integer {
+        size_t operator()(uint64_t v) const { return rtl::_Fnv1a_append_value(rtl::_FNV_offset_basis, v); }
+    };
+    printf("\n%-8s %10s %10s   (M keys per second)\n", "uint64_t", "fnv1a", "rtl::hash");
+    printf("%-8s %10.1f %10.1f\n", "", integer_rate<fnv1a_integer>(values), integer_rate<rtl::hash<uint64_t>>(values));
+    return 0;
+}
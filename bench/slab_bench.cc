@@ -0,0 +1,84 @@
+/// @file alloc/free throughput of malloc, the slab alone and the slab with
+/// per-thread magazines, for 1 .. hardware_concurrency threads
+#include <stdlib.h>
+
+#include <thread>
+#include <vector>
+
+#include "bench/bench.h"
+#include "slab.h"
+
+namespace {
+
+constexpr size_t kLive = 64;            // blocks each thread keeps allocated
+constexpr size_t kOps = 2 * 1000 * 1000;  // alloc/free pairs per thread
+
+enum class mode { malloc, slab, magazine };
+
+const char* const kModeNames[] = {"malloc", "slab", "slab+magazine"};
+
+void worker(mode m, uint64_t seed) {
+    bench::random rnd;
+    rnd.state ^= seed;
+    void* live[kLive] = {};
+    size_t sizes[kLive] = {};
+    for (size_t i = 0; i < kOps; i++) {
+        size_t slot = rnd.next() % kLive;
+        if (live[slot]) {
+            if (m == mode::malloc) {
+                free(live[slot]);
+            } else {
+                rtl::slab_deallocate(live[slot], sizes[slot], PoolTag::NonPaged);
+            }
+        }
+        size_t n = 16 + rnd.next() % (rtl::kSlabMaxSize - 16);
+        live[slot] = m == mode::malloc ? malloc(n) : rtl::slab_allocate(n, PoolTag::NonPaged);
+        sizes[slot] = n;
+        static_cast<char*>(live[slot])[0] = 1;
+    }
+    for (size_t slot = 0; slot < kLive; slot++) {
+        if (m == mode::malloc) {
+            free(live[slot]);
+        } else if (live[slot]) {
+            rtl::slab_deallocate(live[slot], sizes[slot], PoolTag::NonPaged);
+        }
+    }
+}
+
+double run(mode m, size_t threads) {
+    if (m != mode::malloc) {
+        rtl::slab_initialize(m == mode::magazine);
+    }
+    double start = bench::now_seconds();
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; t++) {
+        pool.emplace_back(worker, m, t + 1);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    double elapsed = bench::now_seconds() - start;
+    if (m != mode::malloc) {
+        rtl::slab_uninitialize();
+    }
+    return threads * kOps / elapsed / 1e6;
+}
+
+}  // namespace
+
+int main() {
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 4;
+    }
+    printf("%-8s %16s %16s %16s   (M alloc/free pairs per second)\n", "threads", kModeNames[0], kModeNames[1],
+           kModeNames[2]);
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        printf("%-8zu", threads);
+        for (mode m : {mode::malloc, mode::slab, mode::magazine}) {
+            printf(" %16.1f", run(m, threads));
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -7,6 +7,17 @@
 #define _NODISCARD
 #endif
 
+// check of an internal invariant in debug builds (DBG for the WDK, _DEBUG for MSVC)
+#if defined(_DEBUG) || (defined(DBG) && DBG)
+#if defined(_MSC_VER)
+#define _RTL_ASSERT(expr) ((expr) ? (void)0 : __debugbreak())
+#else
+#define _RTL_ASSERT(expr) ((expr) ? (void)0 : __builtin_trap())
+#endif
+#else
+#define _RTL_ASSERT(expr) ((void)0)
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 //
 // namespace rtl (adapted from MSVC C++17)
@@ -189,6 +200,186 @@ struct remove_reference<_Ty&&> {
 template <class _Ty>
 using remove_reference_t = typename remove_reference<_Ty>::type;
 
+//////////////////////////////////////////////////////////////////////////
+//
+// move / forward
+//
+template <class _Ty>
+_NODISCARD constexpr remove_reference_t<_Ty>&& move(_Ty&& _Arg) noexcept {
+    return static_cast<remove_reference_t<_Ty>&&>(_Arg);
+}
+
+template <class _Ty>
+_NODISCARD constexpr _Ty&& forward(remove_reference_t<_Ty>& _Arg) noexcept {
+    return static_cast<_Ty&&>(_Arg);
+}
+
+template <class _Ty>
+_NODISCARD constexpr _Ty&& forward(remove_reference_t<_Ty>&& _Arg) noexcept {
+    return static_cast<_Ty&&>(_Arg);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// is_trivially_copyable_v
+//
+template <class _Ty>
+constexpr bool is_trivially_copyable_v = __is_trivially_copyable(_Ty);
+
+template <class _Ty>
+struct is_trivially_copyable : bool_constant<is_trivially_copyable_v<_Ty>> {};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// is_trivially_relocatable
+//
+// A type whose objects may be moved to another address with memcpy, the
+// source then being treated as destroyed. Trivially copyable types are;
+// specialize for other types that hold no pointer into themselves, e.g.
+//   template <> struct rtl::is_trivially_relocatable<my_type> : rtl::true_type {};
+//
+template <class _Ty>
+struct is_trivially_relocatable : bool_constant<is_trivially_copyable_v<_Ty>> {};
+
+template <class _Ty>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<_Ty>::value;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// is_trivially_destructible_v
+//
+#if defined(_MSC_VER) || defined(__clang__)
+template <class _Ty>
+constexpr bool is_trivially_destructible_v = __is_trivially_destructible(_Ty);
+#else
+template <class _Ty>
+constexpr bool is_trivially_destructible_v = __has_trivial_destructor(_Ty);
+#endif
+
+template <class _Ty>
+struct is_trivially_destructible : bool_constant<is_trivially_destructible_v<_Ty>> {};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// is_empty_v
+//
+template <class _Ty>
+constexpr bool is_empty_v = __is_empty(_Ty);
+
+template <class _Ty>
+struct is_empty : bool_constant<is_empty_v<_Ty>> {};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// is_final_v
+//
+template <class _Ty>
+constexpr bool is_final_v = __is_final(_Ty);
+
+template <class _Ty>
+struct is_final : bool_constant<is_final_v<_Ty>> {};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// void_t
+//
+template <class... _Types>
+using void_t = void;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// equal_to
+//
+template <class _Ty = void>
+struct equal_to {
+    _NODISCARD constexpr bool operator()(const _Ty& _Left, const _Ty& _Right) const {
+        return _Left == _Right;
+    }
+};
+
+template <>
+struct equal_to<void> {  // transparent, compares any two comparable types
+    using is_transparent = int;
+
+    template <class _Ty1, class _Ty2>
+    _NODISCARD constexpr bool operator()(const _Ty1& _Left, const _Ty2& _Right) const {
+        return _Left == _Right;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// less
+//
+template <class _Ty = void>
+struct less {
+    _NODISCARD constexpr bool operator()(const _Ty& _Left, const _Ty& _Right) const {
+        return _Left < _Right;
+    }
+};
+
+template <>
+struct less<void> {  // transparent, compares any two ordered types
+    using is_transparent = int;
+
+    template <class _Ty1, class _Ty2>
+    _NODISCARD constexpr bool operator()(const _Ty1& _Left, const _Ty2& _Right) const {
+        return _Left < _Right;
+    }
+};
+
+//
+// functor declaring is_transparent, i.e. accepting keys of other types
+//
+template <class _Ty, class = void>
+struct __is_transparent : false_type {};
+
+template <class _Ty>
+struct __is_transparent<_Ty, void_t<typename _Ty::is_transparent>> : true_type {};
+
+template <class _Ty>
+constexpr bool __is_transparent_v = __is_transparent<_Ty>::value;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// pair
+//
+// tag selecting the pair constructor that builds second from all remaining arguments
+struct __pair_emplace_t {
+    explicit __pair_emplace_t() = default;
+};
+
+template <typename K, typename V>
+struct pair {
+    K first = {};
+    V second = {};
+
+    pair() = default;
+    pair(const K& x, const V& y) : first(x), second(y) { ; }
+    pair(const pair& y) = default;
+    pair(pair&& y) = default;
+
+    template <typename U1, typename U2,
+              enable_if_t<!is_same_v<remove_cv_t<remove_reference_t<U1>>, __pair_emplace_t>, int> = 0>
+    pair(U1&& x, U2&& y) : first(rtl::forward<U1>(x)), second(rtl::forward<U2>(y)) { ; }
+
+    template <typename U1, typename... U2>
+    pair(__pair_emplace_t, U1&& x, U2&&... y) : first(rtl::forward<U1>(x)), second(rtl::forward<U2>(y)...) { ; }
+
+    // defaulted, so a pair of trivial types stays trivially copyable and
+    // destructible (and list nodes holding it can be dropped with an arena)
+    ~pair() = default;
+    pair& operator=(const pair& y) = default;
+    pair& operator=(pair&& y) = default;
+};
+
+// emplace arguments that already are a key and a value
+template <typename K, typename... _Valty>
+struct __is_key_and_value : false_type {};
+
+template <typename K, typename _Kty, typename _Vty>
+struct __is_key_and_value<K, _Kty, _Vty> : bool_constant<is_same_v<remove_cv_t<remove_reference_t<_Kty>>, K>> {};
+
 }  // namespace rtl
 
 #endif
\ No newline at end of file
@@ -0,0 +1,402 @@
+/// @file Hash map with striped writer locks and lock-free readers
+#ifndef _CONCURRENT_UNORDERED_MAP_H
+#define _CONCURRENT_UNORDERED_MAP_H
+
+#include "common.h"
+#include "epoch.h"
+#include "hash.h"
+#include "memory.h"
+#include "sync.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// concurrent_unordered_map
+//
+
+///
+/// Hash map safe for concurrent use without an outer lock.
+///
+/// Writers lock one of kStripes spin locks, chosen by the low bits of the
+/// hash, so writers to different stripes run in parallel. In kernel mode
+/// the stripes are held at DISPATCH_LEVEL (dispatch_lock), so writers may
+/// run up to DISPATCH_LEVEL and the allocator must hand out nonpaged memory. Readers take no
+/// lock: they walk the bucket chains inside an epoch section, and erased
+/// nodes are freed only after every reader that could still see them has
+/// left. Values are never modified in place; insert_or_assign publishes a
+/// new node instead. Growing copies the nodes into a new bucket array one
+/// stripe at a time: only the writers of the stripe being copied wait, and
+/// each stripe publishes its own bucket array, so readers keep walking the
+/// old chains until their stripe moves. Growing needs V copy-constructible.
+///
+/// Elements are handed out by copy (find) or to a callback running inside
+/// the read section (visit), never by reference. The callback may insert or
+/// erase, but not call quiesce(), which waits for readers.
+///
+/// @tparam K - key type.
+/// @tparam V - value type.
+/// @tparam Alloc - allocation.
+///
+template <typename K, typename V, typename Hasher = hash<K>, typename KeyEqual = equal_to<K>,
+          typename Alloc = allocator<pair<K, V>, PoolTag::NonPaged>>
+class concurrent_unordered_map {
+   public:
+    using value_type = pair<K, V>;
+    using size_type = size_t;
+    using allocator_type = Alloc;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+   private:
+    struct node {
+        epoch_entry retire;  // first, reclaim casts back
+        node* volatile next;
+        size_t hash;
+        value_type val;
+
+        template <typename... _Valty>
+        node(size_t h, _Valty&&... val) : retire(), next(nullptr), hash(h), val(rtl::forward<_Valty>(val)...) { ; }
+    };
+
+    struct table {
+        epoch_entry retire;  // first, reclaim casts back
+        size_t mask;
+        node* volatile buckets[1];  // mask + 1 buckets
+    };
+
+    using node_allocator = typename Alloc::template rebind<node>::other;
+    using table_allocator = typename Alloc::template rebind<node*>::other;
+
+   public:
+    concurrent_unordered_map() : domain_(this) { publish_all(allocate_table(kMinBuckets)); }
+
+    explicit concurrent_unordered_map(const allocator_type& al)
+        : node_al_(al), table_al_(al), domain_(this) {
+        publish_all(allocate_table(kMinBuckets));
+    }
+
+    ~concurrent_unordered_map() {
+        domain_.barrier();
+        free_table(table_);
+    }
+
+    concurrent_unordered_map(const concurrent_unordered_map&) = delete;
+    concurrent_unordered_map& operator=(const concurrent_unordered_map&) = delete;
+
+    //
+    // readers (lock-free)
+    //
+
+    /// @brief call f(const V&) for the value of key inside the read section
+    /// @return false if key is not present
+    template <typename F>
+    bool visit(const K& key, F&& f) const {
+        size_t h = hasher()(key);
+        epoch_guard guard(domain_);
+        const node* n = find_node(atomic_load_acquire(&stripes_[h & (kStripes - 1)].buckets), key, h);
+        if (n == nullptr) {
+            return false;
+        }
+        f(n->val.second);
+        return true;
+    }
+
+    /// @brief copy the value of key to value
+    bool find(const K& key, V& value) const {
+        return visit(key, [&value](const V& v) { value = v; });
+    }
+
+    bool contains(const K& key) const {
+        return visit(key, [](const V&) { ; });
+    }
+
+    size_type size() const { return static_cast<size_type>(atomic_load(&size_)); }
+
+    _NODISCARD bool empty() const { return size() == 0; }
+
+    size_type bucket_count() const { return atomic_load_acquire(&table_)->mask + 1; }
+
+    //
+    // writers (striped locks)
+    //
+
+    /// @return false if key was already present (nothing is changed)
+    template <typename... _Valty>
+    bool try_emplace(const K& key, _Valty&&... val) {
+        size_t h = hasher()(key);
+        long long size;
+        {
+            lock_guard<dispatch_lock> guard(stripe(h));
+            table* t = stripe_table(h);
+            node* volatile* head = &t->buckets[h & t->mask];
+            if (find_node(t, key, h)) {
+                return false;
+            }
+
+            node* n = allocate_node(h, __pair_emplace_t(), key, rtl::forward<_Valty>(val)...);
+            n->next = *head;
+            atomic_store_release(head, n);
+            size = atomic_add(&size_, 1);
+        }
+
+        grow_if_needed(size);
+        return true;
+    }
+
+    bool insert(const K& key, const V& value) { return try_emplace(key, value); }
+
+    /// @return true if key was inserted, false if its value was replaced
+    bool insert_or_assign(const K& key, const V& value) {
+        size_t h = hasher()(key);
+        node* old = nullptr;
+        long long size = 0;
+        {
+            lock_guard<dispatch_lock> guard(stripe(h));
+            table* t = stripe_table(h);
+            node* volatile* link = find_link(t, key, h);
+            node* n = allocate_node(h, key, value);
+            if (*link) {
+                old = *link;
+                n->next = old->next;
+            } else {
+                n->next = t->buckets[h & t->mask];
+                link = &t->buckets[h & t->mask];
+                size = atomic_add(&size_, 1);
+            }
+            atomic_store_release(link, n);
+        }
+
+        if (old) {
+            domain_.retire(&old->retire, reclaim_node);
+            return false;
+        }
+
+        grow_if_needed(size);
+        return true;
+    }
+
+    /// @return number of elements removed (0 or 1)
+    size_type erase(const K& key) {
+        size_t h = hasher()(key);
+        node* old;
+        {
+            lock_guard<dispatch_lock> guard(stripe(h));
+            node* volatile* link = find_link(stripe_table(h), key, h);
+            old = *link;
+            if (old == nullptr) {
+                return 0;
+            }
+            atomic_store_release(link, old->next);  // readers on old still reach the rest
+            atomic_add(&size_, -1);
+        }
+
+        domain_.retire(&old->retire, reclaim_node);
+        return 1;
+    }
+
+    void clear() {
+        table* t = allocate_table(kMinBuckets);
+        lock_guard<dispatch_lock> resize(resize_lock_);  // no growth half done
+        lock_all();
+        table* old = table_;
+        publish_all(t);
+        size_ = 0;
+        unlock_all();
+
+        domain_.retire(&old->retire, reclaim_table);
+    }
+
+    /// @brief free the nodes retired so far, waiting for current readers
+    /// (not from inside a visit callback)
+    void quiesce() { domain_.barrier(); }
+
+    allocator_type get_allocator() const { return allocator_type(node_al_); }
+
+   private:
+    const node* find_node(const table* t, const K& key, size_t h) const {
+        for (const node* n = atomic_load_acquire(&t->buckets[h & t->mask]); n; n = atomic_load_acquire(&n->next)) {
+            if (n->hash == h && key_equal()(n->val.first, key)) {
+                return n;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @return the link pointing at key's node, or the null link ending its chain
+    node* volatile* find_link(table* t, const K& key, size_t h) {
+        node* volatile* link = &t->buckets[h & t->mask];
+        for (node* n = *link; n; n = *link) {
+            if (n->hash == h && key_equal()(n->val.first, key)) {
+                break;
+            }
+            link = &n->next;
+        }
+        return link;
+    }
+
+    dispatch_lock& stripe(size_t h) { return stripes_[h & (kStripes - 1)].lock; }
+
+    /// @brief the bucket array holding the stripe of h (under its lock)
+    table* stripe_table(size_t h) { return stripes_[h & (kStripes - 1)].buckets; }
+
+    /// @brief make t the bucket array of every stripe
+    void publish_all(table* t) {
+        for (stripe_lock& s : stripes_) {
+            atomic_store_release(&s.buckets, t);
+        }
+        atomic_store_release(&table_, t);
+    }
+
+    void lock_all() {
+        for (stripe_lock& s : stripes_) {
+            s.lock.lock();
+        }
+    }
+
+    /// @brief in reverse order, the first stripe restores the caller's IRQL
+    void unlock_all() {
+        for (size_t i = kStripes; i > 0; i--) {
+            stripes_[i - 1].lock.unlock();
+        }
+    }
+
+    /// @brief double the buckets once the map holds more elements than buckets.
+    /// A bucket and its doubled counterparts belong to the same stripe, so the
+    /// stripes move to the new array one at a time.
+    void grow_if_needed(long long size) {
+        if (static_cast<size_t>(size) <= atomic_load_acquire(&table_)->mask + 1) {
+            return;
+        }
+        if (!resize_lock_.try_lock()) {
+            return;  // someone else is growing (or clearing) it
+        }
+
+        table* old = table_;
+        if (static_cast<size_t>(atomic_load(&size_)) <= old->mask + 1) {
+            resize_lock_.unlock();
+            return;
+        }
+
+        table* t = allocate_table((old->mask + 1) * 2);
+        for (size_t s = 0; s < kStripes; s++) {
+            {
+                lock_guard<dispatch_lock> guard(stripes_[s].lock);
+                copy_stripe(old, t, s);
+                atomic_store_release(&stripes_[s].buckets, t);
+            }
+            retire_stripe(old, s);
+        }
+        atomic_store_release(&table_, t);
+        resize_lock_.unlock();
+
+        domain_.retire(&old->retire, reclaim_buckets);
+    }
+
+    /// @brief copy the nodes of stripe s from old into t, the old chains stay
+    /// intact for readers still walking them
+    void copy_stripe(const table* old, table* t, size_t s) {
+        for (size_t i = s; i <= old->mask; i += kStripes) {
+            for (const node* n = old->buckets[i]; n; n = n->next) {
+                node* copy = allocate_node(n->hash, n->val);
+                copy->next = t->buckets[n->hash & t->mask];
+                t->buckets[n->hash & t->mask] = copy;
+            }
+        }
+    }
+
+    /// @brief retire the nodes of stripe s left in old once the stripe moved:
+    /// nothing writes them any more and new readers no longer reach them
+    void retire_stripe(table* old, size_t s) {
+        for (size_t i = s; i <= old->mask; i += kStripes) {
+            for (node* n = old->buckets[i]; n;) {
+                node* next = n->next;
+                domain_.retire(&n->retire, reclaim_node);
+                n = next;
+            }
+        }
+    }
+
+    template <typename... _Valty>
+    node* allocate_node(size_t h, _Valty&&... val) {
+        node* n = node_al_.allocate(1);
+        assert(n);
+        _RTL_TRACK_CONTAINER(hash_map, 1, sizeof(node));
+        return new (n) node(h, rtl::forward<_Valty>(val)...);
+    }
+
+    void free_node(node* n) {
+        n->~node();
+        node_al_.deallocate(n, 1);
+        _RTL_TRACK_CONTAINER(hash_map, -1, sizeof(node));
+    }
+
+    /// @brief pointer-sized units for a table of buckets entries
+    static size_t table_size(size_t buckets) { return (sizeof(table) - sizeof(node*)) / sizeof(node*) + buckets; }
+
+    table* allocate_table(size_t buckets) {
+        table* t = reinterpret_cast<table*>(table_al_.allocate(table_size(buckets)));
+        assert(t);
+        _RTL_TRACK_CONTAINER(hash_map, 1, table_size(buckets) * sizeof(node*));
+        t->mask = buckets - 1;
+        for (size_t i = 0; i < buckets; i++) {
+            t->buckets[i] = nullptr;
+        }
+        return t;
+    }
+
+    /// @brief free t and the nodes linked in it
+    void free_table(table* t) {
+        size_t buckets = t->mask + 1;
+        for (size_t i = 0; i < buckets; i++) {
+            for (node* n = t->buckets[i]; n;) {
+                node* next = n->next;
+                free_node(n);
+                n = next;
+            }
+        }
+        free_buckets(t);
+    }
+
+    /// @brief free t alone, its nodes were retired on their own
+    void free_buckets(table* t) {
+        size_t buckets = t->mask + 1;
+        _RTL_TRACK_CONTAINER(hash_map, -1, table_size(buckets) * sizeof(node*));
+        table_al_.deallocate(reinterpret_cast<node**>(t), table_size(buckets));
+    }
+
+    static void reclaim_node(void* context, epoch_entry* entry) {
+        static_cast<concurrent_unordered_map*>(context)->free_node(reinterpret_cast<node*>(entry));
+    }
+
+    // a table retired by clear takes the nodes still linked in it along
+    static void reclaim_table(void* context, epoch_entry* entry) {
+        static_cast<concurrent_unordered_map*>(context)->free_table(reinterpret_cast<table*>(entry));
+    }
+
+    // a table retired by growth, whose nodes were retired stripe by stripe
+    static void reclaim_buckets(void* context, epoch_entry* entry) {
+        static_cast<concurrent_unordered_map*>(context)->free_buckets(reinterpret_cast<table*>(entry));
+    }
+
+   private:
+    static constexpr size_type kStripes = 64;           // must be a power of 2
+    static constexpr size_type kMinBuckets = kStripes;  // a bucket belongs to exactly one stripe
+
+    struct alignas(64) stripe_lock {
+        dispatch_lock lock;
+        table* volatile buckets;  // readers and writers of the stripe use this array
+    };
+
+    node_allocator node_al_;
+    table_allocator table_al_;
+    table* volatile table_;  // every stripe has moved to it, sizes the growth
+    volatile long long size_ = 0;
+    stripe_lock stripes_[kStripes];
+    dispatch_lock resize_lock_;  // one growth or clear at a time
+    mutable epoch_domain domain_;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "cpu.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+constexpr unsigned kDetected = 1u << 31;
+
+// written once per racing caller, always with the same value
+volatile unsigned features = 0;
+
+unsigned Bit(rtl::cpu_feature f) {
+    return 1u << static_cast<unsigned>(f);
+}
+
+#if defined(CPU_X86)
+void Cpuid(unsigned leaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    __cpuidex(reinterpret_cast<int*>(regs), static_cast<int>(leaf), 0);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/// @brief register state enabled by the OS in XCR0
+unsigned long long Xcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned eax;
+    unsigned edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+unsigned Detect() {
+    unsigned bits = kDetected;
+#if defined(CPU_X86)
+    unsigned regs[4];
+    Cpuid(0, regs);
+    unsigned max_leaf = regs[0];
+
+    Cpuid(1, regs);
+    bits |= (regs[2] & (1u << 20)) ? Bit(rtl::cpu_feature::sse42) : 0;
+    bits |= (regs[2] & (1u << 23)) ? Bit(rtl::cpu_feature::popcnt) : 0;
+
+    // AVX2 needs the OS to save the YMM registers (XCR0 bits 1 and 2)
+    bool ymm = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && (Xcr0() & 6) == 6;
+    if (ymm && max_leaf >= 7) {
+        Cpuid(7, regs);
+        bits |= (regs[1] & (1u << 5)) ? Bit(rtl::cpu_feature::avx2) : 0;
+    }
+#endif
+    return bits;
+}
+
+}  // namespace
+
+bool rtl::cpu_has(cpu_feature f) noexcept {
+    unsigned bits = features;
+    if (bits == 0) {
+        bits = Detect();
+        features = bits;
+    }
+    return (bits & Bit(f)) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+/// @file CPU feature detection
+#ifndef _CPU_H
+#define _CPU_H
+
+namespace rtl {
+
+//
+// Instruction set extensions picked at run time. Features needing OS
+// support for their register state (AVX2) are only reported when the OS
+// saves that state; kernel code must still save it itself before use.
+//
+enum class cpu_feature {
+    sse42,
+    popcnt,
+    avx2,
+};
+
+/// @brief the CPU supports f, detected on the first call
+bool cpu_has(cpu_feature f) noexcept;
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
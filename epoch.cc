@@ -0,0 +1,109 @@
+#include "epoch.h"
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+
+static size_t CurrentSlot() {
+    return KeGetCurrentProcessorNumberEx(nullptr);
+}
+#else
+static volatile long long next_slot = 0;
+
+static size_t CurrentSlot() {
+    static thread_local size_t slot = static_cast<size_t>(rtl::atomic_add(&next_slot, 1));
+    return slot;
+}
+#endif
+
+//
+// A reader announces itself in the counter of the epoch it read, then checks
+// the epoch again; try_advance() reads the counters, then advances the epoch.
+// With a full barrier between the two steps on both sides, either the reader
+// sees the new epoch and backs off, or try_advance() sees the reader.
+//
+size_t rtl::epoch_domain::enter() noexcept {
+    size_t slot = CurrentSlot() % kEpochSlots;
+    for (;;) {
+        long long epoch = atomic_load(&epoch_);
+        atomic_add(&slots_[slot].active[epoch & 1], 1);
+        atomic_fence();
+        if (atomic_load(&epoch_) == epoch) {
+            return slot << 1 | static_cast<size_t>(epoch & 1);
+        }
+        atomic_add(&slots_[slot].active[epoch & 1], -1);
+    }
+}
+
+void rtl::epoch_domain::leave(size_t token) noexcept {
+    atomic_fence();  // the section's reads complete before the reader is gone
+    atomic_add(&slots_[token >> 1].active[token & 1], -1);
+}
+
+//
+// Advancing from e to e + 1 needs the readers of e - 1 (same parity as
+// e + 1) to be gone. Readers still in e entered after the objects retired
+// in e - 1 were unlinked, so limbo e - 1 is freed on reaching e + 1.
+//
+rtl::epoch_entry* rtl::epoch_domain::try_advance(bool& advanced) {
+    long long epoch = atomic_load(&epoch_);
+    for (Slot& slot : slots_) {
+        if (atomic_load(&slot.active[(epoch + 1) & 1])) {
+            advanced = false;
+            return nullptr;
+        }
+    }
+
+    atomic_fence();  // the counters were read before the epoch moves
+    atomic_add(&epoch_, 1);
+    atomic_fence();
+
+    advanced = true;
+    epoch_entry*& safe = limbo_[(epoch + 2) % 3];
+    epoch_entry* list = safe;
+    safe = nullptr;
+    return list;
+}
+
+void rtl::epoch_domain::synchronize() {
+    // readers active now are in epoch e or e - 1, all gone at e + 2
+    long long target = atomic_load(&epoch_) + 2;
+    while (atomic_load(&epoch_) < target) {
+        bool advanced;
+        epoch_entry* list;
+        {
+            lock_guard<dispatch_lock> guard(lock_);
+            list = try_advance(advanced);
+        }
+        reclaim(list);
+        if (!advanced) {
+            cpu_relax();
+        }
+    }
+}
+
+void rtl::epoch_domain::retire(epoch_entry* entry, void (*reclaim)(void* context, epoch_entry* entry)) {
+    entry->reclaim = reclaim;
+
+    epoch_entry* list = nullptr;
+    {
+        lock_guard<dispatch_lock> guard(lock_);
+        epoch_entry*& limbo = limbo_[atomic_load(&epoch_) % 3];
+        entry->next = limbo;
+        limbo = entry;
+        if (++retired_count_ >= kEpochRetireBatch) {
+            retired_count_ = 0;
+            bool advanced;
+            list = try_advance(advanced);
+        }
+    }
+
+    this->reclaim(list);
+}
+
+void rtl::epoch_domain::reclaim(epoch_entry* list) {
+    while (list) {
+        epoch_entry* next = list->next;
+        list->reclaim(context_, list);
+        list = next;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/// @file Epoch based reclamation for lock-free readers
+#ifndef _EPOCH_H
+#define _EPOCH_H
+
+#include <cstddef>
+
+#include "sync.h"
+
+namespace rtl {
+
+//
+// Readers bracket their accesses with enter()/leave() (or an epoch_guard),
+// which only touches a counter in the reader's own slot (CPU, or thread in
+// user mode). Writers unlink objects and retire() them; a retired object is
+// reclaimed once every reader that might still see it has left.
+//
+// An object retired in epoch e is kept in limbo until the epoch reaches
+// e + 2. The epoch advances from e to e + 1 once no reader of epoch e - 1 is
+// left. retire() only tries that every kEpochRetireBatch calls and never
+// waits, so writers may retire from inside a read section (e.g. erase
+// from a visit callback). synchronize() and barrier() do wait for readers and
+// must not be called from inside a read section.
+//
+// In kernel mode the writer lock is held at DISPATCH_LEVEL: retired objects
+// must be nonpaged, and the reclaim function runs at the caller's IRQL.
+//
+constexpr size_t kEpochSlots = 64;
+constexpr size_t kEpochRetireBatch = 64;
+
+/// @brief link embedded in retired objects, filled in by retire()
+struct epoch_entry {
+    epoch_entry* next;
+    void (*reclaim)(void* context, epoch_entry* entry);
+};
+
+class epoch_domain {
+   public:
+    /// @param context - passed to the reclaim function of every entry
+    explicit epoch_domain(void* context = nullptr) : context_(context) { ; }
+
+    /// @brief reclaims what is still pending, no reader may be active
+    ~epoch_domain() { barrier(); }
+
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    /// @return token for leave()
+    size_t enter() noexcept;
+    void leave(size_t token) noexcept;
+
+    /// @brief free entry with reclaim(context, entry) once no reader can hold it.
+    /// The object must already be unreachable for new readers. Never waits.
+    void retire(epoch_entry* entry, void (*reclaim)(void* context, epoch_entry* entry));
+
+    /// @brief wait until every reader active at the time of the call has left,
+    /// reclaiming what that makes safe (not from inside a read section)
+    void synchronize();
+
+    /// @brief synchronize, which reclaims everything retired so far
+    void barrier() { synchronize(); }
+
+   private:
+    struct alignas(64) Slot {
+        volatile long long active[2];  // readers in an even / odd epoch
+    };
+
+    /// @brief advance the epoch if the readers of the previous one are gone
+    /// (lock_ held), returning the limbo list that became safe
+    epoch_entry* try_advance(bool& advanced);
+
+    void reclaim(epoch_entry* list);
+
+    Slot slots_[kEpochSlots] = {};
+    volatile long long epoch_ = 0;
+
+    dispatch_lock lock_;
+    epoch_entry* limbo_[3] = {};  // retired in epoch e, at limbo_[e % 3]
+    size_t retired_count_ = 0;
+    void* context_;
+};
+
+///
+/// Read-side critical section
+///
+class epoch_guard {
+   public:
+    explicit epoch_guard(epoch_domain& domain) : domain_(domain), token_(domain.enter()) { ; }
+    ~epoch_guard() { domain_.leave(token_); }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard& operator=(const epoch_guard&) = delete;
+
+   private:
+    epoch_domain& domain_;
+    size_t token_;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
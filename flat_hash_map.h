@@ -0,0 +1,531 @@
+/// @file Open addressing hash map (Swiss table)
+#ifndef _FLAT_HASH_MAP_H
+#define _FLAT_HASH_MAP_H
+
+#include <string.h>
+
+#include "common.h"
+#include "hash.h"
+#include "memory.h"
+#include "simd.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// control bytes
+//
+// Every slot has one control byte: empty, deleted, or, when full, the low
+// 7 bits of the hash (h2). A lookup compares h2 against a whole group of
+// control bytes at once and only touches the slots that match.
+//
+using __ctrl_t = signed char;
+
+constexpr __ctrl_t kCtrlEmpty = -128;
+constexpr __ctrl_t kCtrlDeleted = -2;
+constexpr __ctrl_t kCtrlSentinel = -1;  // after the last slot, stops iteration
+
+constexpr size_t kCtrlGroupWidth = 16;
+
+//
+// 16 control bytes, with SSE2 or one byte at a time
+//
+class __ctrl_group {
+   public:
+    explicit __ctrl_group(const __ctrl_t* p)
+#if defined(_RTL_SSE2)
+        : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {
+        ;
+    }
+#else
+        : ctrl_(p) {
+        ;
+    }
+#endif
+
+    /// @return bit i set when byte i equals h2
+    unsigned match(__ctrl_t h2) const {
+#if defined(_RTL_SSE2)
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2))));
+#else
+        unsigned mask = 0;
+        for (size_t i = 0; i < kCtrlGroupWidth; i++) {
+            mask |= static_cast<unsigned>(ctrl_[i] == h2) << i;
+        }
+        return mask;
+#endif
+    }
+
+    unsigned match_empty() const {
+        return match(kCtrlEmpty);
+    }
+
+    unsigned match_empty_or_deleted() const {
+#if defined(_RTL_SSE2)
+        return static_cast<unsigned>(_mm_movemask_epi8(ctrl_));  // both have the sign bit set
+#else
+        unsigned mask = 0;
+        for (size_t i = 0; i < kCtrlGroupWidth; i++) {
+            mask |= static_cast<unsigned>(ctrl_[i] < kCtrlSentinel) << i;
+        }
+        return mask;
+#endif
+    }
+
+   private:
+#if defined(_RTL_SSE2)
+    __m128i ctrl_;
+#else
+    const __ctrl_t* ctrl_;
+#endif
+};
+
+//
+// iterator
+//
+template <class T>
+class __flat_hash_iterator {
+   public:
+    __flat_hash_iterator() = default;
+    __flat_hash_iterator(const __ctrl_t* ctrl, T* slot) : ctrl_(ctrl), slot_(slot) { skip(); }
+
+    template <class U>
+    __flat_hash_iterator(const __flat_hash_iterator<U>& it) : ctrl_(it.ctrl_), slot_(it.slot_) { ; }
+
+    T& operator*() const {
+        return *slot_;
+    }
+
+    T* operator->() const {
+        return slot_;
+    }
+
+    __flat_hash_iterator& operator++() {
+        ++ctrl_;
+        ++slot_;
+        skip();
+        return *this;
+    }
+
+    __flat_hash_iterator operator++(int) {
+        __flat_hash_iterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    bool operator==(const __flat_hash_iterator& it) const {
+        return slot_ == it.slot_;
+    }
+
+    bool operator!=(const __flat_hash_iterator& it) const {
+        return slot_ != it.slot_;
+    }
+
+   private:
+    template <class U>
+    friend class __flat_hash_iterator;
+
+    template <typename K, typename V, typename Hasher, typename Alloc>
+    friend class flat_hash_map;
+
+    /// @brief advance to the next full slot or the sentinel
+    void skip() {
+        while (ctrl_ && *ctrl_ < kCtrlSentinel) {
+            ++ctrl_;
+            ++slot_;
+        }
+    }
+
+    const __ctrl_t* ctrl_ = nullptr;
+    T* slot_ = nullptr;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// flat_hash_map
+//
+
+///
+/// Hash map keeping its elements inline in a single allocation: the control
+/// bytes followed by the slots. Collisions are resolved by probing groups of
+/// kCtrlGroupWidth slots, so a lookup usually costs one miss on the control
+/// bytes and one on the slot. Inserting or erasing invalidates iterators.
+///
+/// @tparam K - key type.
+/// @tparam V - value type.
+/// @tparam Alloc - allocation.
+///
+template <typename K, typename V, typename Hasher = hash<K>, typename Alloc = allocator<pair<K, V>, PoolTag::Paged>>
+class flat_hash_map : private __alloc_holder<Alloc> {
+   public:
+    using value_type = pair<K, V>;
+    using size_type = size_t;
+    using allocator_type = Alloc;
+    using hasher = Hasher;
+    using iterator = __flat_hash_iterator<value_type>;
+    using const_iterator = __flat_hash_iterator<const value_type>;
+
+   public:
+    flat_hash_map() = default;
+
+    explicit flat_hash_map(const allocator_type& al) : __alloc_holder<Alloc>(al) { ; }
+
+    flat_hash_map(const flat_hash_map& other) : __alloc_holder<Alloc>(other.get_al()) {
+        reserve(other.size_);
+        for (const value_type& val : other) {
+            size_t h = hasher()(val.first);
+            new (slots_ + prepare_insert(h)) value_type(val);
+        }
+    }
+
+    flat_hash_map(flat_hash_map&& other) noexcept : __alloc_holder<Alloc>(other.get_al()) {
+        swap(other);
+    }
+
+    ~flat_hash_map() {
+        destroy_slots();
+        free_table();
+    }
+
+    flat_hash_map& operator=(const flat_hash_map& other) {
+        if (this != &other) {
+            flat_hash_map tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_hash_map& operator=(flat_hash_map&& other) noexcept {
+        if (this != &other) {
+            flat_hash_map tmp(rtl::move(other));
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    void swap(flat_hash_map& other) noexcept {
+        allocator_type al = this->get_al();
+        this->get_al() = other.get_al();
+        other.get_al() = al;
+
+        swap(ctrl_, other.ctrl_);
+        swap(slots_, other.slots_);
+        swap(capacity_, other.capacity_);
+        swap(size_, other.size_);
+        swap(growth_left_, other.growth_left_);
+    }
+
+    /// @brief insert value_type(val...) unless its key is present. A (key, value)
+    /// argument pair is looked up before anything is built, other arguments
+    /// make a temporary value_type that is moved into the slot.
+    template <typename... _Valty>
+    pair<iterator, bool> emplace(_Valty&&... val) {
+        if constexpr (__is_key_and_value<K, _Valty...>::value) {
+            return try_emplace(rtl::forward<_Valty>(val)...);
+        } else {
+            value_type tmp(rtl::forward<_Valty>(val)...);
+            return try_emplace(rtl::move(tmp.first), rtl::move(tmp.second));
+        }
+    }
+
+    /// @brief insert (key, V(val...)) unless key is present; on a hit no value
+    /// is built, copied or destroyed
+    template <typename... _Valty>
+    pair<iterator, bool> try_emplace(const K& key, _Valty&&... val) {
+        return try_emplace_hashed(hasher()(key), key, rtl::forward<_Valty>(val)...);
+    }
+
+    template <typename... _Valty>
+    pair<iterator, bool> try_emplace(K&& key, _Valty&&... val) {
+        size_t h = hasher()(key);
+        return try_emplace_hashed(h, rtl::move(key), rtl::forward<_Valty>(val)...);
+    }
+
+    pair<iterator, bool> insert(const value_type& val) {
+        return try_emplace(val.first, val.second);
+    }
+
+    iterator begin() { return iterator_at(0); }
+
+    iterator end() { return iterator_at(capacity_); }
+
+    const_iterator begin() const { return const_iterator_at(0); }
+
+    const_iterator end() const { return const_iterator_at(capacity_); }
+
+    iterator find(const K& key) { return iterator_at(find_index(key, hasher()(key))); }
+
+    const_iterator find(const K& key) const { return const_iterator_at(find_index(key, hasher()(key))); }
+
+    /// @brief find keys[0, n) into out[0, n) (end() when missing). Keys are
+    /// handled kBatch at a time: the control group of every key is prefetched,
+    /// then the slot of its first tag match, before any key is compared.
+    void find_batch(const K* keys, size_type n, iterator* out) {
+        size_t hashes[kBatch];
+        for (size_type first = 0; first < n; first += kBatch) {
+            size_type count = n - first < kBatch ? n - first : kBatch;
+            for (size_type i = 0; i < count; i++) {
+                hashes[i] = hasher()(keys[first + i]);
+                if (capacity_) {
+                    prefetch(ctrl_ + h1(hashes[i]) * kCtrlGroupWidth);
+                }
+            }
+            for (size_type i = 0; i < count && capacity_; i++) {
+                size_t group = h1(hashes[i]);
+                unsigned mask = __ctrl_group(ctrl_ + group * kCtrlGroupWidth).match(h2(hashes[i]));
+                if (mask) {
+                    prefetch(slots_ + group * kCtrlGroupWidth + countr_zero(mask));
+                }
+            }
+            for (size_type i = 0; i < count; i++) {
+                out[first + i] = iterator_at(find_index(keys[first + i], hashes[i]));
+            }
+        }
+    }
+
+    /// @brief insert vals[0, n) like insert, hashing and prefetching the
+    /// control groups of kBatch values before inserting them
+    /// @return number of values inserted (keys not already present)
+    size_type insert_batch(const value_type* vals, size_type n) {
+        reserve(size_ + n);
+
+        size_t hashes[kBatch];
+        size_type inserted = 0;
+        for (size_type first = 0; first < n; first += kBatch) {
+            size_type count = n - first < kBatch ? n - first : kBatch;
+            for (size_type i = 0; i < count; i++) {
+                hashes[i] = hasher()(vals[first + i].first);
+                prefetch(ctrl_ + h1(hashes[i]) * kCtrlGroupWidth);
+            }
+            for (size_type i = 0; i < count; i++) {
+                const value_type& val = vals[first + i];
+                inserted += try_emplace_hashed(hashes[i], val.first, val.second).second;
+            }
+        }
+        return inserted;
+    }
+
+    size_type erase(const K& key) {
+        size_t i = find_index(key, hasher()(key));
+        if (i != capacity_) {
+            erase_index(i);
+            return 1;
+        }
+        return 0;
+    }
+
+    iterator erase(const_iterator it) {
+        size_t i = it.slot_ - slots_;
+        erase_index(i);
+        return iterator_at(i);
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+    V& operator[](K&& key) { return try_emplace(rtl::move(key)).first->second; }
+
+    /// @brief destroy all elements, keeping the table
+    void clear() {
+        destroy_slots();
+        if (capacity_) {
+            memset(ctrl_, kCtrlEmpty, capacity_);
+            growth_left_ = max_size_for(capacity_);
+        }
+        size_ = 0;
+    }
+
+    /// @brief make room for n elements without further rehashing
+    void reserve(size_type n) {
+        if (n > size_ + growth_left_) {
+            size_t cap = kMinCapacity;
+            while (max_size_for(cap) < n) {
+                cap *= 2;
+            }
+            resize(cap);
+        }
+    }
+
+    _NODISCARD bool empty() const { return size_ == 0; }
+
+    size_type size() const { return size_; }
+
+    size_type bucket_count() const { return capacity_; }
+
+    allocator_type get_allocator() const { return this->get_al(); }
+
+   private:
+    /// @brief try_emplace with the hash of key already computed
+    template <typename Key, typename... _Valty>
+    pair<iterator, bool> try_emplace_hashed(size_t h, Key&& key, _Valty&&... val) {
+        size_t i = find_index(key, h);
+        if (i != capacity_) {
+            return pair<iterator, bool>(iterator_at(i), false);
+        }
+
+        i = prepare_insert(h);
+        new (slots_ + i) value_type(__pair_emplace_t(), rtl::forward<Key>(key), rtl::forward<_Valty>(val)...);
+        return pair<iterator, bool>(iterator_at(i), true);
+    }
+
+    iterator iterator_at(size_t i) { return iterator(ctrl_ + i, slots_ + i); }
+
+    const_iterator const_iterator_at(size_t i) const { return const_iterator(ctrl_ + i, slots_ + i); }
+
+    static __ctrl_t h2(size_t h) { return static_cast<__ctrl_t>(h & 0x7f); }
+
+    /// @brief first group of the probe sequence
+    size_t h1(size_t h) const { return (h >> 7) & (capacity_ / kCtrlGroupWidth - 1); }
+
+    /// @brief keep 1/8 of the slots empty so every probe sequence terminates
+    static size_t max_size_for(size_t cap) { return cap - cap / 8; }
+
+    /// @return index of the slot holding key, or capacity_
+    size_t find_index(const K& key, size_t h) const {
+        if (capacity_ == 0) {
+            return 0;
+        }
+
+        size_t groups_mask = capacity_ / kCtrlGroupWidth - 1;
+        size_t group = h1(h);
+        for (size_t step = 1;; step++) {
+            __ctrl_group g(ctrl_ + group * kCtrlGroupWidth);
+            for (unsigned mask = g.match(h2(h)); mask; mask &= mask - 1) {
+                size_t i = group * kCtrlGroupWidth + countr_zero(mask);
+                if (slots_[i].first == key) {
+                    return i;
+                }
+            }
+            if (g.match_empty()) {
+                return capacity_;
+            }
+            group = (group + step) & groups_mask;  // triangular probing visits every group
+        }
+    }
+
+    /// @return index of the first empty or deleted slot on the probe sequence of h
+    size_t find_free(size_t h) const {
+        size_t groups_mask = capacity_ / kCtrlGroupWidth - 1;
+        size_t group = h1(h);
+        for (size_t step = 1;; step++) {
+            unsigned mask = __ctrl_group(ctrl_ + group * kCtrlGroupWidth).match_empty_or_deleted();
+            if (mask) {
+                return group * kCtrlGroupWidth + countr_zero(mask);
+            }
+            group = (group + step) & groups_mask;
+        }
+    }
+
+    /// @brief claim a slot for a new element with hash h, growing if needed
+    size_t prepare_insert(size_t h) {
+        if (growth_left_ == 0) {
+            // drop tombstones in place when they are the reason the table is full
+            resize(capacity_ == 0 ? kMinCapacity : size_ * 16 <= capacity_ * 7 ? capacity_ : capacity_ * 2);
+        }
+
+        size_t i = find_free(h);
+        growth_left_ -= ctrl_[i] == kCtrlEmpty;
+        ctrl_[i] = h2(h);
+        size_++;
+        return i;
+    }
+
+    void erase_index(size_t i) {
+        slots_[i].~value_type();
+        size_--;
+
+        // no probe sequence went past a group that still has an empty slot,
+        // so the slot can become empty again instead of a tombstone
+        if (__ctrl_group(ctrl_ + (i & ~(kCtrlGroupWidth - 1))).match_empty()) {
+            ctrl_[i] = kCtrlEmpty;
+            growth_left_++;
+        } else {
+            ctrl_[i] = kCtrlDeleted;
+        }
+    }
+
+    /// @brief move every element into a new table of cap slots
+    void resize(size_t cap) {
+        __ctrl_t* old_ctrl = ctrl_;
+        value_type* old_slots = slots_;
+        size_t old_capacity = capacity_;
+
+        allocate_table(cap);
+        growth_left_ -= size_;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_ctrl[i] >= 0) {
+                size_t h = hasher()(old_slots[i].first);
+                size_t j = find_free(h);
+                ctrl_[j] = h2(h);
+                new (slots_ + j) value_type(rtl::move(old_slots[i]));
+                old_slots[i].~value_type();
+            }
+        }
+
+        if (old_ctrl) {
+            _RTL_TRACK_CONTAINER(hash_map, -1, table_size(old_capacity) * sizeof(value_type));
+            this->get_al().deallocate(reinterpret_cast<value_type*>(old_ctrl), table_size(old_capacity));
+        }
+    }
+
+    /// @brief slots needed in front of the table for cap + 1 control bytes
+    static size_t ctrl_slots(size_t cap) { return (cap + 1 + sizeof(value_type) - 1) / sizeof(value_type); }
+
+    static size_t table_size(size_t cap) { return ctrl_slots(cap) + cap; }
+
+    void allocate_table(size_t cap) {
+        value_type* p = this->get_al().allocate(table_size(cap));
+        assert(p);
+        _RTL_TRACK_CONTAINER(hash_map, 1, table_size(cap) * sizeof(value_type));
+
+        ctrl_ = reinterpret_cast<__ctrl_t*>(p);
+        memset(ctrl_, kCtrlEmpty, cap);
+        ctrl_[cap] = kCtrlSentinel;
+        slots_ = p + ctrl_slots(cap);
+        capacity_ = cap;
+        growth_left_ = max_size_for(cap);
+    }
+
+    void free_table() {
+        if (ctrl_) {
+            _RTL_TRACK_CONTAINER(hash_map, -1, table_size(capacity_) * sizeof(value_type));
+            this->get_al().deallocate(reinterpret_cast<value_type*>(ctrl_), table_size(capacity_));
+        }
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        growth_left_ = 0;
+    }
+
+    void destroy_slots() {
+        if (!is_trivially_destructible_v<value_type>) {
+            for (size_t i = 0; i < capacity_; i++) {
+                if (ctrl_[i] >= 0) {
+                    slots_[i].~value_type();
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    static void swap(T& x, T& y) {
+        T tmp = x;
+        x = y;
+        y = tmp;
+    }
+
+   private:
+    static constexpr size_type kMinCapacity = kCtrlGroupWidth;  // must be a power of 2 multiple of the group
+    static constexpr size_type kBatch = 16;  // keys in flight in find_batch/insert_batch
+
+    __ctrl_t* ctrl_ = nullptr;
+    value_type* slots_ = nullptr;
+    size_type capacity_ = 0;
+    size_type size_ = 0;
+    size_type growth_left_ = 0;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
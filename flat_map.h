@@ -0,0 +1,413 @@
+/// @file Ordered map kept as sorted arrays
+#ifndef _FLAT_MAP_H
+#define _FLAT_MAP_H
+
+#include "common.h"
+#include "memory.h"
+#include "simd.h"
+#include "vector.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// flat_map iterator
+//
+// Keys and values live in two arrays, so there is no pair to point at:
+// dereferencing yields a pair of references, and operator-> hands out the
+// same object, which forwards -> to itself.
+//
+template <class K, class V>
+struct __flat_map_ref {
+    const K& first;
+    V& second;
+
+    __flat_map_ref* operator->() {
+        return this;
+    }
+};
+
+template <class K, class V>
+class __flat_map_iterator {
+   public:
+    using reference = __flat_map_ref<K, V>;
+
+    __flat_map_iterator() = default;
+    __flat_map_iterator(const K* key, V* value) : key_(key), value_(value) { ; }
+
+    template <class U>
+    __flat_map_iterator(const __flat_map_iterator<K, U>& it) : key_(it.key_), value_(it.value_) { ; }
+
+    reference operator*() const {
+        return reference{*key_, *value_};
+    }
+
+    reference operator->() const {
+        return **this;
+    }
+
+    __flat_map_iterator& operator++() {
+        ++key_;
+        ++value_;
+        return *this;
+    }
+
+    __flat_map_iterator operator++(int) {
+        __flat_map_iterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    __flat_map_iterator& operator--() {
+        --key_;
+        --value_;
+        return *this;
+    }
+
+    __flat_map_iterator operator--(int) {
+        __flat_map_iterator tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    __flat_map_iterator operator+(ptrdiff_t n) const {
+        return __flat_map_iterator(key_ + n, value_ + n);
+    }
+
+    ptrdiff_t operator-(const __flat_map_iterator& it) const {
+        return key_ - it.key_;
+    }
+
+    bool operator==(const __flat_map_iterator& it) const {
+        return key_ == it.key_;
+    }
+
+    bool operator!=(const __flat_map_iterator& it) const {
+        return key_ != it.key_;
+    }
+
+   private:
+    template <class, class>
+    friend class __flat_map_iterator;
+
+    template <typename, typename, typename, typename>
+    friend class flat_map;
+
+    const K* key_ = nullptr;
+    V* value_ = nullptr;
+};
+
+#if defined(_RTL_SSE2)
+//
+// Number of keys[0, n) less than key for 32-bit integers, four at a time.
+// On sorted keys that is the lower bound.
+//
+template <class K>
+size_t __count_less(const K* keys, size_t n, K key) {
+    constexpr bool kSigned = K(-1) < K(0);
+    // SSE2 only compares signed, flipping the top bit orders unsigned the same way
+    const __m128i bias = _mm_set1_epi32(kSigned ? 0 : static_cast<int>(0x80000000u));
+    const __m128i k = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(key)), bias);
+
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias);
+        acc = _mm_sub_epi32(acc, _mm_cmplt_epi32(v, k));  // true lanes are -1
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    size_t count = static_cast<size_t>(_mm_cvtsi128_si32(acc));
+    for (; i < n; i++) {
+        count += keys[i] < key;
+    }
+    return count;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// flat_map
+//
+
+///
+/// Ordered map storing its keys and its values in two sorted vectors.
+///
+/// Meant for small maps and maps built once and then read: no allocation per
+/// element, iteration walks contiguous memory, and lookups only touch the
+/// key array. Lookups are a branchless binary search; small maps of 32-bit
+/// integer keys are scanned linearly with SSE2 instead. Inserting or erasing
+/// in the middle shifts the elements behind it, so build large maps in bulk
+/// with the range constructor or insert(first, last), which sort once.
+///
+/// Iterators and references are invalidated by every insertion and erasure.
+///
+/// @tparam K - key type.
+/// @tparam V - value type.
+/// @tparam Compare - strict weak ordering of the keys.
+/// @tparam Alloc - allocation, rebound for the key and value arrays.
+///
+template <typename K, typename V, typename Compare = less<K>, typename Alloc = allocator<pair<K, V>, PoolTag::Paged>>
+class flat_map {
+   public:
+    using value_type = pair<K, V>;
+    using size_type = size_t;
+    using allocator_type = Alloc;
+    using key_compare = Compare;
+    using iterator = __flat_map_iterator<K, V>;
+    using const_iterator = __flat_map_iterator<K, const V>;
+
+   private:
+    using key_vector = vector<K, typename Alloc::template rebind<K>::other>;
+    using value_vector = vector<V, typename Alloc::template rebind<V>::other>;
+    using pair_vector = vector<value_type, Alloc>;
+
+#if defined(_RTL_SSE2)
+    static constexpr bool kScanKeys =
+        is_integral_v<K> && sizeof(K) == 4 && (is_same_v<Compare, less<K>> || is_same_v<Compare, less<>>);
+#else
+    static constexpr bool kScanKeys = false;
+#endif
+
+   public:
+    flat_map() = default;
+
+    explicit flat_map(const allocator_type& al) : keys_(al), values_(al) { ; }
+
+    /// @brief build from the value_type range [first, last), sorting once.
+    /// Of repeated keys the first one is kept, as with repeated insert.
+    template <typename Iter>
+    flat_map(Iter first, Iter last, const allocator_type& al = allocator_type()) : keys_(al), values_(al) {
+        insert(first, last);
+    }
+
+    /// @brief insert (key, V(val...)) unless key is present
+    template <typename... _Valty>
+    pair<iterator, bool> try_emplace(const K& key, _Valty&&... val) {
+        size_type i = lower_index(key);
+        if (i != size() && !key_compare()(key, keys_[i])) {
+            return pair<iterator, bool>(iterator_at(i), false);
+        }
+
+        keys_.emplace(keys_.begin() + i, key);
+        values_.emplace(values_.begin() + i, rtl::forward<_Valty>(val)...);
+        return pair<iterator, bool>(iterator_at(i), true);
+    }
+
+    template <typename... _Valty>
+    pair<iterator, bool> emplace(const K& key, _Valty&&... val) {
+        return try_emplace(key, rtl::forward<_Valty>(val)...);
+    }
+
+    pair<iterator, bool> insert(const value_type& val) {
+        return try_emplace(val.first, val.second);
+    }
+
+    /// @brief insert the value_type range [first, last) with a single sort.
+    /// Keys already present, and repeats within the range, are skipped.
+    template <typename Iter>
+    void insert(Iter first, Iter last) {
+        pair_vector tmp(keys_.get_allocator());
+        tmp.reserve(size() + __distance(first, last));
+        for (size_type i = 0; i < size(); i++) {
+            tmp.emplace_back(rtl::move(keys_[i]), rtl::move(values_[i]));
+        }
+        for (; first != last; ++first) {
+            tmp.push_back(*first);
+        }
+
+        // stable, so the elements already here win over the new ones
+        stable_sort(tmp);
+        keys_.clear();
+        values_.clear();
+        keys_.reserve(tmp.size());
+        values_.reserve(tmp.size());
+        for (value_type& val : tmp) {
+            if (keys_.empty() || key_compare()(keys_.back(), val.first)) {
+                keys_.push_back(rtl::move(val.first));
+                values_.push_back(rtl::move(val.second));
+            }
+        }
+    }
+
+    /// @brief assign obj to the value of key, inserting it if not present
+    template <typename Obj>
+    pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj) {
+        pair<iterator, bool> r = try_emplace(key, rtl::forward<Obj>(obj));
+        if (!r.second) {
+            values_[index_of(r.first)] = rtl::forward<Obj>(obj);
+        }
+        return r;
+    }
+
+    V& operator[](const K& key) {
+        return values_[index_of(try_emplace(key).first)];
+    }
+
+    iterator begin() { return iterator_at(0); }
+
+    iterator end() { return iterator_at(size()); }
+
+    const_iterator begin() const { return const_iterator_at(0); }
+
+    const_iterator end() const { return const_iterator_at(size()); }
+
+    /// @brief first element whose key is not less than key
+    iterator lower_bound(const K& key) { return iterator_at(lower_index(key)); }
+
+    const_iterator lower_bound(const K& key) const { return const_iterator_at(lower_index(key)); }
+
+    iterator find(const K& key) { return iterator_at(find_index(key)); }
+
+    const_iterator find(const K& key) const { return const_iterator_at(find_index(key)); }
+
+    bool contains(const K& key) const { return find_index(key) != size(); }
+
+    size_type erase(const K& key) {
+        size_type i = find_index(key);
+        if (i == size()) {
+            return 0;
+        }
+        erase_index(i);
+        return 1;
+    }
+
+    iterator erase(const_iterator it) {
+        size_type i = it.key_ - keys_.data();
+        erase_index(i);
+        return iterator_at(i);
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    void clear() {
+        keys_.clear();
+        values_.clear();
+    }
+
+    void reserve(size_type n) {
+        keys_.reserve(n);
+        values_.reserve(n);
+    }
+
+    void shrink_to_fit() {
+        keys_.shrink_to_fit();
+        values_.shrink_to_fit();
+    }
+
+    /// @brief the sorted keys, values() holds their values at the same positions
+    const key_vector& keys() const { return keys_; }
+
+    const value_vector& values() const { return values_; }
+
+    _NODISCARD bool empty() const { return keys_.empty(); }
+
+    size_type size() const { return keys_.size(); }
+
+    allocator_type get_allocator() const { return allocator_type(keys_.get_allocator()); }
+
+   private:
+    iterator iterator_at(size_type i) { return iterator(keys_.data() + i, values_.data() + i); }
+
+    const_iterator const_iterator_at(size_type i) const { return const_iterator(keys_.data() + i, values_.data() + i); }
+
+    size_type index_of(iterator it) { return it.key_ - keys_.data(); }
+
+    /// @return index of the first key not less than key
+    size_type lower_index(const K& key) const {
+        const K* base = keys_.data();
+        size_type n = size();
+#if defined(_RTL_SSE2)
+        if constexpr (kScanKeys) {
+            if (n <= kScanSize) {
+                return __count_less(base, n, key);
+            }
+        }
+#endif
+        if (n == 0) {
+            return 0;
+        }
+
+        // the answer stays in [base, base + n], the select compiles to a cmov
+        while (n > 1) {
+            size_type half = n / 2;
+            base = key_compare()(base[half], key) ? base + half : base;
+            n -= half;
+        }
+        return (base - keys_.data()) + key_compare()(*base, key);
+    }
+
+    /// @return index of key, or size()
+    size_type find_index(const K& key) const {
+        size_type i = lower_index(key);
+        return i != size() && !key_compare()(key, keys_[i]) ? i : size();
+    }
+
+    void erase_index(size_type i) {
+        keys_.erase(keys_.begin() + i);
+        values_.erase(values_.begin() + i);
+    }
+
+    //
+    // Stable merge sort by key: runs of kSortRun are insertion sorted in
+    // place, then merged pairwise into a second buffer, doubling each pass.
+    //
+    void stable_sort(pair_vector& v) {
+        size_type n = v.size();
+        for (size_type lo = 0; lo < n; lo += kSortRun) {
+            insertion_sort(v.data() + lo, v.data() + (n - lo < kSortRun ? n : lo + kSortRun));
+        }
+
+        pair_vector tmp(v.get_allocator());
+        tmp.reserve(n);
+        for (size_type width = kSortRun; width < n; width *= 2) {
+            value_type* src = v.data();
+            for (size_type lo = 0; lo < n; lo += 2 * width) {
+                size_type mid = n - lo < width ? n : lo + width;
+                size_type hi = n - mid < width ? n : mid + width;
+                size_type i = lo;
+                size_type j = mid;
+                while (i < mid && j < hi) {
+                    // on equal keys the left run goes first
+                    tmp.push_back(rtl::move(key_compare()(src[j].first, src[i].first) ? src[j++] : src[i++]));
+                }
+                while (i < mid) {
+                    tmp.push_back(rtl::move(src[i++]));
+                }
+                while (j < hi) {
+                    tmp.push_back(rtl::move(src[j++]));
+                }
+            }
+            v.swap(tmp);
+            tmp.clear();
+        }
+    }
+
+    static void insertion_sort(value_type* first, value_type* last) {
+        for (value_type* it = first + 1; it < last; ++it) {
+            if (!key_compare()(it->first, it[-1].first)) {
+                continue;
+            }
+
+            value_type tmp(rtl::move(*it));
+            value_type* hole = it;
+            do {
+                *hole = rtl::move(hole[-1]);
+                --hole;
+            } while (hole != first && key_compare()(tmp.first, hole[-1].first));
+            *hole = rtl::move(tmp);
+        }
+    }
+
+   private:
+    static constexpr size_type kScanSize = 32;  // largest map scanned linearly
+    static constexpr size_type kSortRun = 16;
+
+    key_vector keys_;
+    value_vector values_;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "frozen_map.h"
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+
+static HANDLE OpenImageFile(const wchar_t* path, ACCESS_MASK access, ULONG disposition) {
+    UNICODE_STRING name;
+    RtlInitUnicodeString(&name, path);
+    OBJECT_ATTRIBUTES attributes;
+    InitializeObjectAttributes(&attributes, &name, OBJ_KERNEL_HANDLE | OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+
+    HANDLE file;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status = ZwCreateFile(&file, access | SYNCHRONIZE, &attributes, &io, nullptr, FILE_ATTRIBUTE_NORMAL,
+                                   FILE_SHARE_READ, disposition,
+                                   FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE, nullptr, 0);
+    return NT_SUCCESS(status) ? file : nullptr;
+}
+
+bool rtl::frozen_image::load(const path_char* path, PoolTag tag) {
+    reset();
+
+    HANDLE file = OpenImageFile(path, GENERIC_READ, FILE_OPEN);
+    if (file == nullptr) {
+        return false;
+    }
+
+    IO_STATUS_BLOCK io;
+    FILE_STANDARD_INFORMATION info;
+    NTSTATUS status = ZwQueryInformationFile(file, &io, &info, sizeof(info), FileStandardInformation);
+    if (!NT_SUCCESS(status) || info.EndOfFile.QuadPart <= 0 || info.EndOfFile.QuadPart > MAXULONG) {
+        ZwClose(file);
+        return false;
+    }
+
+    // one allocation and one read, the image is used where it lands
+    ULONG size = static_cast<ULONG>(info.EndOfFile.QuadPart);
+    void* p = operator new(size, tag);
+    if (p == nullptr) {
+        ZwClose(file);
+        return false;
+    }
+
+    LARGE_INTEGER offset = {};
+    status = ZwReadFile(file, nullptr, nullptr, nullptr, &io, p, size, &offset, nullptr);
+    ZwClose(file);
+    if (!NT_SUCCESS(status) || io.Information != size) {
+        operator delete(p, tag);
+        return false;
+    }
+
+    data_ = p;
+    size_ = size;
+    tag_ = tag;
+    return true;
+}
+
+bool rtl::frozen_image::save(const path_char* path, const void* data, size_t size) {
+    if (size > MAXULONG) {
+        return false;
+    }
+
+    HANDLE file = OpenImageFile(path, GENERIC_WRITE, FILE_OVERWRITE_IF);
+    if (file == nullptr) {
+        return false;
+    }
+
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER offset = {};
+    NTSTATUS status = ZwWriteFile(file, nullptr, nullptr, nullptr, &io, const_cast<void*>(data),
+                                  static_cast<ULONG>(size), &offset, nullptr);
+    ZwClose(file);
+    return NT_SUCCESS(status) && io.Information == size;
+}
+
+void rtl::frozen_image::reset() {
+    if (data_) {
+        operator delete(data_, tag_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+#elif defined(_WIN32)
+#include <stdio.h>
+#include <windows.h>
+
+bool rtl::frozen_image::load(const path_char* path, PoolTag tag) {
+    reset();
+    tag_ = tag;
+
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the view keeps the mapping (and the file) alive after the handles are closed
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return false;
+    }
+
+    void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (p == nullptr) {
+        return false;
+    }
+
+    data_ = p;
+    size_ = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+bool rtl::frozen_image::save(const path_char* path, const void* data, size_t size) {
+    FILE* file = _wfopen(path, L"wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+void rtl::frozen_image::reset() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool rtl::frozen_image::load(const path_char* path, PoolTag tag) {
+    reset();
+    tag_ = tag;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    data_ = p;
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+bool rtl::frozen_image::save(const path_char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+void rtl::frozen_image::reset() {
+    if (data_) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,302 @@
+/// @file Relocatable hash table images, queried in place
+#ifndef _FROZEN_MAP_H
+#define _FROZEN_MAP_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "hash.h"
+#include "new.h"
+#include "unordered_map.h"
+#include "vector.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// image layout
+//
+// One contiguous block holding no pointers, every position is an offset
+// from the start of the image:
+//
+//   frozen_header
+//   uint32_t starts[buckets + 1]  elements of bucket b are [starts[b], starts[b + 1])
+//   uint64_t hashes[count]        hash of every element
+//   pair<K, V> entries[count]     grouped by bucket
+//
+// Hashes are computed when the image is built, so an image can only be read
+// by code using the same hasher and the same word size, which the header
+// records together with the key and value sizes.
+//
+constexpr uint32_t kFrozenMagic = 0x5a46524b;  // "KRFZ"
+constexpr uint32_t kFrozenVersion = 2;  // 2: word-at-a-time hash family
+
+struct frozen_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t word_size;  // sizeof(size_t) of the builder
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t entry_size;
+    uint64_t count;
+    uint64_t buckets;  // a power of 2
+    uint64_t starts_offset;
+    uint64_t hashes_offset;
+    uint64_t entries_offset;
+    uint64_t size;  // of the whole image
+};
+
+/// @brief round n up to a multiple of align (a power of 2)
+constexpr uint64_t __frozen_align(uint64_t n, uint64_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// frozen_map_view
+//
+
+///
+/// Read-only map over an image written by freeze(), found in place without
+/// copying or allocating. The view does not own the image, which must stay
+/// mapped (see frozen_image) while the view is used.
+///
+/// Keys and values are stored bytewise, so both must be trivially copyable.
+///
+/// @tparam Hasher, KeyEqual - must match the ones the image was frozen with.
+///
+template <typename K, typename V, typename Hasher = hash<K>, typename KeyEqual = equal_to<K>>
+class frozen_map_view {
+    static_assert(is_trivially_copyable_v<K> && is_trivially_copyable_v<V>,
+                  "frozen images store keys and values bytewise");
+
+   public:
+    using value_type = pair<K, V>;
+    using size_type = size_t;
+    using const_iterator = const value_type*;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    static_assert(alignof(value_type) <= kPoolAlignment, "entries are aligned to the pool alignment at most");
+
+    frozen_map_view() = default;
+
+    /// @brief view the image [data, data + size); an image that fails the
+    /// header checks (see valid) gives an empty view
+    frozen_map_view(const void* data, size_t size) {
+        if (check(data, size)) {
+            const unsigned char* base = static_cast<const unsigned char*>(data);
+            const frozen_header* header = static_cast<const frozen_header*>(data);
+            starts_ = reinterpret_cast<const uint32_t*>(base + header->starts_offset);
+            hashes_ = reinterpret_cast<const uint64_t*>(base + header->hashes_offset);
+            entries_ = reinterpret_cast<const value_type*>(base + header->entries_offset);
+            count_ = static_cast<size_type>(header->count);
+            mask_ = static_cast<size_type>(header->buckets - 1);
+        }
+    }
+
+    /// @brief the image passed the checks, built for this K, V and word size
+    bool valid() const { return starts_ != nullptr; }
+
+    const_iterator begin() const { return entries_; }
+
+    const_iterator end() const { return entries_ + count_; }
+
+    const_iterator find(const K& key) const {
+        if (!valid()) {
+            return end();
+        }
+
+        size_t h = hasher()(key);
+        size_type bucket = h & mask_;
+        for (uint32_t i = starts_[bucket]; i < starts_[bucket + 1]; i++) {
+            if (hashes_[i] == h && key_equal()(entries_[i].first, key)) {
+                return entries_ + i;
+            }
+        }
+        return end();
+    }
+
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    _NODISCARD bool empty() const { return count_ == 0; }
+
+    size_type size() const { return count_; }
+
+    size_type bucket_count() const { return valid() ? mask_ + 1 : 0; }
+
+   private:
+    /// @brief the header matches this instantiation and every offset lies in the image
+    static bool check(const void* data, size_t size) {
+        if (data == nullptr || size < sizeof(frozen_header) ||
+            reinterpret_cast<uintptr_t>(data) % alignof(value_type) != 0) {
+            return false;
+        }
+
+        const frozen_header* header = static_cast<const frozen_header*>(data);
+        if (header->magic != kFrozenMagic || header->version != kFrozenVersion ||
+            header->word_size != sizeof(size_t) || header->key_size != sizeof(K) ||
+            header->value_size != sizeof(V) || header->entry_size != sizeof(value_type) || header->size > size) {
+            return false;
+        }
+
+        uint64_t buckets = header->buckets;
+        uint64_t count = header->count;
+        if (buckets == 0 || (buckets & (buckets - 1)) != 0 || buckets > UINT32_MAX || count > UINT32_MAX ||
+            header->starts_offset % alignof(uint32_t) != 0 || header->hashes_offset % alignof(uint64_t) != 0 ||
+            header->entries_offset % alignof(value_type) != 0 ||
+            !fits(header->starts_offset, buckets + 1, sizeof(uint32_t), header->size) ||
+            !fits(header->hashes_offset, count, sizeof(uint64_t), header->size) ||
+            !fits(header->entries_offset, count, sizeof(value_type), header->size)) {
+            return false;
+        }
+
+        // bucket ranges must be ordered and end at count, or find would leave the image
+        const uint32_t* starts =
+            reinterpret_cast<const uint32_t*>(static_cast<const unsigned char*>(data) + header->starts_offset);
+        for (uint64_t b = 0; b < buckets; b++) {
+            if (starts[b] > starts[b + 1]) {
+                return false;
+            }
+        }
+        return starts[0] == 0 && starts[buckets] == count;
+    }
+
+    /// @brief n elements of width bytes at offset lie within size bytes; the
+    /// offset is checked first so untrusted values cannot wrap the sum
+    static bool fits(uint64_t offset, uint64_t n, uint64_t width, uint64_t size) {
+        return offset <= size && n <= (size - offset) / width;
+    }
+
+    const uint32_t* starts_ = nullptr;
+    const uint64_t* hashes_ = nullptr;
+    const value_type* entries_ = nullptr;
+    size_type count_ = 0;
+    size_type mask_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// freeze
+//
+
+/// @brief write the image of map into image (replacing its contents), to be
+/// saved with frozen_image::save and read with frozen_map_view
+template <typename K, typename V, typename Hasher, typename KeyEqual, typename Alloc, typename ImageAlloc>
+void freeze(const unordered_map<K, V, Hasher, KeyEqual, Alloc>& map, vector<unsigned char, ImageAlloc>& image) {
+    using value_type = pair<K, V>;
+    static_assert(is_trivially_copyable_v<K> && is_trivially_copyable_v<V>,
+                  "frozen images store keys and values bytewise");
+
+    uint64_t count = map.size();
+    uint64_t buckets = 1;
+    while (buckets < count) {
+        buckets *= 2;
+    }
+
+    frozen_header header = {};
+    header.magic = kFrozenMagic;
+    header.version = kFrozenVersion;
+    header.word_size = sizeof(size_t);
+    header.key_size = sizeof(K);
+    header.value_size = sizeof(V);
+    header.entry_size = sizeof(value_type);
+    header.count = count;
+    header.buckets = buckets;
+    header.starts_offset = __frozen_align(sizeof(frozen_header), alignof(uint64_t));
+    header.hashes_offset = __frozen_align(header.starts_offset + (buckets + 1) * sizeof(uint32_t), alignof(uint64_t));
+    header.entries_offset = __frozen_align(header.hashes_offset + count * sizeof(uint64_t), kPoolAlignment);
+    header.size = header.entries_offset + count * sizeof(value_type);
+
+    image.clear();
+    image.resize(static_cast<size_t>(header.size), 0);  // padding included, equal maps give equal images
+    unsigned char* base = image.data();
+    memcpy(base, &header, sizeof(header));
+    uint32_t* starts = reinterpret_cast<uint32_t*>(base + header.starts_offset);
+    uint64_t* hashes = reinterpret_cast<uint64_t*>(base + header.hashes_offset);
+    value_type* entries = reinterpret_cast<value_type*>(base + header.entries_offset);
+
+    // counting sort by bucket: sizes, then starts, then place using starts[b + 1]
+    // as the cursor of bucket b, which leaves it at the end of b
+    for (const value_type& val : map) {
+        starts[(Hasher()(val.first) & (buckets - 1)) + 1]++;
+    }
+    for (uint64_t b = 1; b <= buckets; b++) {
+        starts[b] += starts[b - 1];
+    }
+    for (uint64_t b = buckets; b > 0; b--) {
+        starts[b] = starts[b - 1];
+    }
+    for (const value_type& val : map) {
+        size_t h = Hasher()(val.first);
+        uint32_t i = starts[(h & (buckets - 1)) + 1]++;
+        hashes[i] = h;
+        new (entries + i) value_type(val.first, val.second);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// frozen_image
+//
+
+#if defined(_WIN32)
+using path_char = wchar_t;
+#else
+using path_char = char;
+#endif
+
+///
+/// Owner of a loaded image file: mapped read-only in user mode, read into a
+/// single pool allocation in kernel mode (paths are then NT paths such as
+/// L"\\??\\C:\\table.bin", and load/save must run at PASSIVE_LEVEL).
+///
+class frozen_image {
+   public:
+    frozen_image() = default;
+    ~frozen_image() { reset(); }
+
+    frozen_image(const frozen_image&) = delete;
+    frozen_image& operator=(const frozen_image&) = delete;
+
+    frozen_image(frozen_image&& other) noexcept : data_(other.data_), size_(other.size_), tag_(other.tag_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    frozen_image& operator=(frozen_image&& other) noexcept {
+        if (this != &other) {
+            reset();
+            data_ = other.data_;
+            size_ = other.size_;
+            tag_ = other.tag_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    /// @brief replace the image by the contents of the file at path
+    /// @param tag - pool of the kernel allocation, unused in user mode
+    bool load(const path_char* path, PoolTag tag = PoolTag::Paged);
+
+    /// @brief write [data, data + size) to the file at path, replacing it
+    static bool save(const path_char* path, const void* data, size_t size);
+
+    /// @brief unmap or free the image
+    void reset();
+
+    const void* data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+   private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    PoolTag tag_ = PoolTag::Paged;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
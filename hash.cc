@@ -0,0 +1,78 @@
+#include "hash.h"
+
+#include "cpu.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CRC32C_SSE42 1
+#include <nmmintrin.h>
+
+#if defined(_MSC_VER)
+#define CRC32C_TARGET
+#else
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace {
+
+// reflected CRC-32C polynomial
+constexpr uint32_t kCrc32cPoly = 0x82f63b78;
+
+struct CrcTable {
+    uint32_t v[256];
+
+    constexpr CrcTable() : v() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (kCrc32cPoly & (0u - (crc & 1)));
+            }
+            v[i] = crc;
+        }
+    }
+};
+
+constexpr CrcTable kCrcTable;
+
+uint32_t Crc32cSoftware(const unsigned char* p, size_t n, uint32_t crc) {
+    for (size_t i = 0; i < n; i++) {
+        crc = kCrcTable.v[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_SSE42)
+// crc32 works on general purpose registers, so this is safe in kernel mode too
+CRC32C_TARGET uint32_t Crc32cHardware(const unsigned char* p, size_t n, uint32_t crc) {
+#if defined(_M_X64) || defined(__x86_64__)
+    unsigned long long crc64 = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        unsigned long long v;
+        memcpy(&v, p, sizeof(v));
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; n >= 4; n -= 4, p += 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+    }
+    for (; n > 0; n--, p++) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+}  // namespace
+
+uint32_t rtl::crc32c(const void* data, size_t n, uint32_t crc) noexcept {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+#if defined(CRC32C_SSE42)
+    if (cpu_has(cpu_feature::sse42)) {
+        return ~Crc32cHardware(p, n, ~crc);
+    }
+#endif
+    return ~Crc32cSoftware(p, n, ~crc);
+}
\ No newline at end of file
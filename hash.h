@@ -3,6 +3,12 @@
 
 #include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #include "common.h"
 
@@ -67,11 +73,234 @@ _NODISCARD size_t _Fnv1a_append_value(
     return _Fnv1a_append_bytes(_Val, &reinterpret_cast<const unsigned char&>(_Keyval), sizeof(_Kty));
 }
 
+//////////////////////////////////////////////////////////////////////////
+//
+// word-at-a-time hashing
+//
+// Integers and pointers go through a single multiply-fold, byte ranges are
+// consumed 16 bytes per step in the manner of wyhash. Both leave the low and
+// the high bits well mixed: the containers mask the low bits, flat_hash_map
+// splits off the high ones too. The results are the same on every CPU (and
+// across runs), which frozen images rely on.
+//
+constexpr uint64_t _Hash_secret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+                                      0x589965cc75374cc3ull};
+
+/// @brief _Hash_multiply from four 32x32 -> 64 bit products, the cross sum cannot overflow
+constexpr void _Hash_multiply_portable(uint64_t& _Left, uint64_t& _Right) noexcept {
+    uint64_t _Lo_lo = (_Left & 0xffffffff) * (_Right & 0xffffffff);
+    uint64_t _Hi_lo = (_Left >> 32) * (_Right & 0xffffffff);
+    uint64_t _Lo_hi = (_Left & 0xffffffff) * (_Right >> 32);
+    uint64_t _Hi_hi = (_Left >> 32) * (_Right >> 32);
+    uint64_t _Cross = (_Lo_lo >> 32) + (_Hi_lo & 0xffffffff) + _Lo_hi;
+    _Left = (_Cross << 32) | (_Lo_lo & 0xffffffff);
+    _Right = (_Hi_lo >> 32) + (_Cross >> 32) + _Hi_hi;
+}
+
+/// @brief full 64x64 bit product, low half to _Left and high half to _Right
+inline void _Hash_multiply(uint64_t& _Left, uint64_t& _Right) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t _Product = static_cast<__uint128_t>(_Left) * _Right;
+    _Left = static_cast<uint64_t>(_Product);
+    _Right = static_cast<uint64_t>(_Product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    _Left = _umul128(_Left, _Right, &_Right);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    uint64_t _High = __umulh(_Left, _Right);
+    _Left *= _Right;
+    _Right = _High;
+#else
+    _Hash_multiply_portable(_Left, _Right);
+#endif
+}
+
+/// @brief 128 bit product folded to 64 bits
+_NODISCARD inline uint64_t _Hash_mix(uint64_t _Left, uint64_t _Right) noexcept {
+    _Hash_multiply(_Left, _Right);
+    return _Left ^ _Right;
+}
+
+/// @brief fold a 64 bit hash into size_t
+_NODISCARD constexpr size_t _Hash_result(uint64_t _Val) noexcept {
+    if constexpr (sizeof(size_t) < sizeof(uint64_t)) {
+        return static_cast<size_t>(_Val ^ (_Val >> 32));
+    } else {
+        return static_cast<size_t>(_Val);
+    }
+}
+
+/// @brief hash of an integer (or pointer) value
+_NODISCARD inline uint64_t _Hash_integer(uint64_t _Val) noexcept {
+    return _Hash_mix(_Val ^ _Hash_secret[0], _Hash_secret[1]);
+}
+
+_NODISCARD inline uint64_t _Hash_read64(const unsigned char* _Ptr) noexcept {
+    uint64_t _Val;
+    memcpy(&_Val, _Ptr, sizeof(_Val));
+    return _Val;
+}
+
+_NODISCARD inline uint64_t _Hash_read32(const unsigned char* _Ptr) noexcept {
+    uint32_t _Val;
+    memcpy(&_Val, _Ptr, sizeof(_Val));
+    return _Val;
+}
+
+/// @brief hash of the bytes [_Data, _Data + _Count)
+_NODISCARD inline uint64_t _Hash_bytes(const void* _Data, size_t _Count, uint64_t _Seed = 0) noexcept {
+    const unsigned char* _First = static_cast<const unsigned char*>(_Data);
+    _Seed ^= _Hash_mix(_Seed ^ _Hash_secret[0], _Hash_secret[1]);
+
+    uint64_t _A;
+    uint64_t _B;
+    if (_Count <= 16) {
+        if (_Count >= 4) {
+            // two (possibly overlapping) reads from each end cover 4..16 bytes
+            size_t _Mid = (_Count >> 3) << 2;
+            _A = (_Hash_read32(_First) << 32) | _Hash_read32(_First + _Mid);
+            _B = (_Hash_read32(_First + _Count - 4) << 32) | _Hash_read32(_First + _Count - 4 - _Mid);
+        } else if (_Count > 0) {
+            _A = (uint64_t(_First[0]) << 16) | (uint64_t(_First[_Count >> 1]) << 8) | _First[_Count - 1];
+            _B = 0;
+        } else {
+            _A = 0;
+            _B = 0;
+        }
+    } else {
+        size_t _Left = _Count;
+        if (_Left > 48) {
+            // three independent lanes keep the multipliers busy
+            uint64_t _Seed1 = _Seed;
+            uint64_t _Seed2 = _Seed;
+            do {
+                _Seed = _Hash_mix(_Hash_read64(_First) ^ _Hash_secret[1], _Hash_read64(_First + 8) ^ _Seed);
+                _Seed1 = _Hash_mix(_Hash_read64(_First + 16) ^ _Hash_secret[2], _Hash_read64(_First + 24) ^ _Seed1);
+                _Seed2 = _Hash_mix(_Hash_read64(_First + 32) ^ _Hash_secret[3], _Hash_read64(_First + 40) ^ _Seed2);
+                _First += 48;
+                _Left -= 48;
+            } while (_Left > 48);
+            _Seed ^= _Seed1 ^ _Seed2;
+        }
+        while (_Left > 16) {
+            _Seed = _Hash_mix(_Hash_read64(_First) ^ _Hash_secret[1], _Hash_read64(_First + 8) ^ _Seed);
+            _First += 16;
+            _Left -= 16;
+        }
+        // the last 16 bytes, overlapping what was already consumed
+        _A = _Hash_read64(_First + _Left - 16);
+        _B = _Hash_read64(_First + _Left - 8);
+    }
+
+    _A ^= _Hash_secret[1];
+    _B ^= _Seed;
+    _Hash_multiply(_A, _B);
+    return _Hash_mix(_A ^ _Hash_secret[0] ^ _Count, _B ^ _Hash_secret[1]);
+}
+
+//
+// constexpr twins of _Hash_integer and _Hash_bytes, giving the same values,
+// for keys known at compile time (see static_map.h). They read one byte at
+// a time (little endian, like the loads above) and multiply in 32 bit
+// halves, so use them in constant expressions only.
+//
+_NODISCARD constexpr uint64_t _Hash_mix_constexpr(uint64_t _Left, uint64_t _Right) noexcept {
+    _Hash_multiply_portable(_Left, _Right);
+    return _Left ^ _Right;
+}
+
+_NODISCARD constexpr uint64_t _Hash_integer_constexpr(uint64_t _Val) noexcept {
+    return _Hash_mix_constexpr(_Val ^ _Hash_secret[0], _Hash_secret[1]);
+}
+
+/// @brief _Bytes bytes at byte offset _Offset of the array _First
+template <class _Elem>
+_NODISCARD constexpr uint64_t _Hash_read_constexpr(const _Elem* _First, size_t _Offset, size_t _Bytes) noexcept {
+    uint64_t _Val = 0;
+    for (size_t _Idx = 0; _Idx < _Bytes; ++_Idx) {
+        size_t _Byte = _Offset + _Idx;
+        uint64_t _Part = (static_cast<uint64_t>(_First[_Byte / sizeof(_Elem)]) >> (_Byte % sizeof(_Elem) * 8)) & 0xff;
+        _Val |= _Part << (_Idx * 8);
+    }
+    return _Val;
+}
+
+/// @brief _Hash_bytes of the first _Count bytes of the array _First
+template <class _Elem>
+_NODISCARD constexpr uint64_t _Hash_bytes_constexpr(const _Elem* _First, size_t _Count, uint64_t _Seed = 0) noexcept {
+    _Seed ^= _Hash_mix_constexpr(_Seed ^ _Hash_secret[0], _Hash_secret[1]);
+
+    uint64_t _A = 0;
+    uint64_t _B = 0;
+    if (_Count <= 16) {
+        if (_Count >= 4) {
+            size_t _Mid = (_Count >> 3) << 2;
+            _A = (_Hash_read_constexpr(_First, 0, 4) << 32) | _Hash_read_constexpr(_First, _Mid, 4);
+            _B = (_Hash_read_constexpr(_First, _Count - 4, 4) << 32) | _Hash_read_constexpr(_First, _Count - 4 - _Mid, 4);
+        } else if (_Count > 0) {
+            _A = (_Hash_read_constexpr(_First, 0, 1) << 16) | (_Hash_read_constexpr(_First, _Count >> 1, 1) << 8) |
+                 _Hash_read_constexpr(_First, _Count - 1, 1);
+        }
+    } else {
+        size_t _Pos = 0;
+        size_t _Left = _Count;
+        if (_Left > 48) {
+            uint64_t _Seed1 = _Seed;
+            uint64_t _Seed2 = _Seed;
+            do {
+                _Seed = _Hash_mix_constexpr(_Hash_read_constexpr(_First, _Pos, 8) ^ _Hash_secret[1],
+                                            _Hash_read_constexpr(_First, _Pos + 8, 8) ^ _Seed);
+                _Seed1 = _Hash_mix_constexpr(_Hash_read_constexpr(_First, _Pos + 16, 8) ^ _Hash_secret[2],
+                                             _Hash_read_constexpr(_First, _Pos + 24, 8) ^ _Seed1);
+                _Seed2 = _Hash_mix_constexpr(_Hash_read_constexpr(_First, _Pos + 32, 8) ^ _Hash_secret[3],
+                                             _Hash_read_constexpr(_First, _Pos + 40, 8) ^ _Seed2);
+                _Pos += 48;
+                _Left -= 48;
+            } while (_Left > 48);
+            _Seed ^= _Seed1 ^ _Seed2;
+        }
+        while (_Left > 16) {
+            _Seed = _Hash_mix_constexpr(_Hash_read_constexpr(_First, _Pos, 8) ^ _Hash_secret[1],
+                                        _Hash_read_constexpr(_First, _Pos + 8, 8) ^ _Seed);
+            _Pos += 16;
+            _Left -= 16;
+        }
+        _A = _Hash_read_constexpr(_First, _Pos + _Left - 16, 8);
+        _B = _Hash_read_constexpr(_First, _Pos + _Left - 8, 8);
+    }
+
+    _A ^= _Hash_secret[1];
+    _B ^= _Seed;
+    _Hash_multiply_portable(_A, _B);
+    return _Hash_mix_constexpr(_A ^ _Hash_secret[0] ^ _Count, _B ^ _Hash_secret[1]);
+}
+
+/// @brief hash<_Kty>()(_Keyval) of an integral key, as a constant expression
+template <class _Kty, enable_if_t<is_integral_v<_Kty>, int> = 0>
+_NODISCARD constexpr size_t hash_constexpr(_Kty _Keyval) noexcept {
+    return _Hash_result(_Hash_integer_constexpr(static_cast<uint64_t>(_Keyval)));
+}
+
+/// @brief hash<basic_string<_Elem>>() of the characters [_Str, _Str + _Size), as a constant expression
+template <class _Elem>
+_NODISCARD constexpr size_t hash_constexpr(const _Elem* _Str, size_t _Size) noexcept {
+    return _Hash_result(_Hash_bytes_constexpr(_Str, _Size * sizeof(_Elem)));
+}
+
+/// @brief the same for a string literal, without its terminator
+template <class _Elem, size_t _Size>
+_NODISCARD constexpr size_t hash_constexpr(const _Elem (&_Str)[_Size]) noexcept {
+    return hash_constexpr(_Str, _Size - 1);
+}
+
 template <class _Kty>
 _NODISCARD size_t _Hash_representation(const _Kty& _Keyval) noexcept {  // bitwise hashes the representation of a key
-    return _Fnv1a_append_value(_FNV_offset_basis, _Keyval);
+    return _Hash_result(_Hash_bytes(&_Keyval, sizeof(_Kty)));
 }
 
+/// @brief CRC-32C (Castagnoli) of [data, data + n), continuing from crc. Uses
+/// the SSE4.2 crc32 instruction when the CPU has one, with the same result.
+uint32_t crc32c(const void* data, size_t n, uint32_t crc = 0) noexcept;
+
 template <class _Kty>
 struct hash;
 
@@ -104,9 +333,24 @@ template <class _Kty>
 struct hash : _Conditionally_enabled_hash<_Kty, !is_const_v<_Kty> && (is_integral_v<_Kty> || is_pointer_v<_Kty>)> {
     // hash functor primary template (handles enums, integrals, and pointers)
     static size_t _Do_hash(const _Kty& _Keyval) noexcept {
-        // // hash _Keyval to size_t value by pseudorandomizing transform
-        // return Fnv32::calcHash(_Keyval);
-        return _Hash_representation(_Keyval);
+        // hash _Keyval to size_t value by pseudorandomizing transform
+        if constexpr (is_pointer_v<_Kty>) {
+            return _Hash_result(_Hash_integer(reinterpret_cast<uintptr_t>(_Keyval)));
+        } else {
+            return _Hash_result(_Hash_integer(static_cast<uint64_t>(_Keyval)));
+        }
+    }
+};
+
+//
+// Hash built on crc32c(), for byte-heavy keys on CPUs with SSE4.2 (see the
+// basic_string specialization in string.h). The CRC is mixed once more, as
+// its own bits are linear in the input.
+//
+template <class _Kty>
+struct crc32c_hash {
+    _NODISCARD size_t operator()(const _Kty& _Keyval) const noexcept {
+        return _Hash_result(_Hash_integer(crc32c(&_Keyval, sizeof(_Kty))));
     }
 };
 
@@ -17,7 +17,7 @@ struct __list_val : public ListEntry {
 
     __list_val() = delete;
     template <typename... _Valty>
-    __list_val(_Valty&&... val) : val_(val...), ListEntry() { ; }
+    __list_val(_Valty&&... val) : ListEntry(), val_(rtl::forward<_Valty>(val)...) { ; }
 };
 
 //
@@ -84,30 +84,166 @@ struct __list_iterator {
     }
 };
 
-template <typename T, class Alloc = allocator<T>>
-class list {
+//
+// node handle: owns a node extracted from a list (or a container built on
+// one) until it is inserted into another or destroyed with it
+//
+template <class Node, class NodeAlloc>
+class __list_node_handle : private __alloc_holder<NodeAlloc> {
+   public:
+    using allocator_type = NodeAlloc;
+
+    __list_node_handle() = default;
+
+    __list_node_handle(__list_node_handle&& other) noexcept
+        : __alloc_holder<NodeAlloc>(other.get_al()), ptr_(other.ptr_), hash_tag_(other.hash_tag_) {
+        other.ptr_ = nullptr;
+    }
+
+    __list_node_handle& operator=(__list_node_handle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            this->get_al() = other.get_al();
+            ptr_ = other.ptr_;
+            hash_tag_ = other.hash_tag_;
+            other.ptr_ = nullptr;
+        }
+        return *this;
+    }
+
+    __list_node_handle(const __list_node_handle&) = delete;
+    __list_node_handle& operator=(const __list_node_handle&) = delete;
+
+    ~__list_node_handle() { reset(); }
+
+    _NODISCARD bool empty() const {
+        return ptr_ == nullptr;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+    const auto& value() const {
+        return ptr_->val_;
+    }
+
+    // mutable access may change the key, see hash_tag()
+    auto& value() {
+        hash_tag_ = nullptr;
+        return ptr_->val_;
+    }
+
+    // for pair values (map nodes)
+    const auto& key() const {
+        return ptr_->val_.first;
+    }
+
+    auto& key() {
+        hash_tag_ = nullptr;
+        return ptr_->val_.first;
+    }
+
+    auto& mapped() const {
+        return ptr_->val_.second;
+    }
+
+    _NODISCARD allocator_type get_allocator() const {
+        return this->get_al();
+    }
+
+    /// @brief identifies the hash function the container that extracted the
+    ///        node cached in it; null when unknown or the key may have been
+    ///        written since, so that state must not be trusted
+    _NODISCARD const void* hash_tag() const {
+        return hash_tag_;
+    }
+
+    void __set_hash_tag(const void* tag) {
+        hash_tag_ = tag;
+    }
+
+    /// @brief the owned node, for containers reading their own per-node state
+    Node* __node() const {
+        return ptr_;
+    }
+
+   private:
+    template <typename T, class Alloc, class N>
+    friend class list;
+
+    __list_node_handle(Node* ptr, const NodeAlloc& al) : __alloc_holder<NodeAlloc>(al), ptr_(ptr) { ; }
+
+    /// @brief give up ownership of the node
+    Node* release() {
+        Node* ptr = ptr_;
+        ptr_ = nullptr;
+        hash_tag_ = nullptr;
+        return ptr;
+    }
+
+    void reset() {
+        if (ptr_) {
+            ptr_->~Node();
+            this->get_al().deallocate(ptr_, 1);
+            _RTL_TRACK_CONTAINER(list, -1, sizeof(Node));
+            ptr_ = nullptr;
+        }
+        hash_tag_ = nullptr;
+    }
+
+    Node* ptr_ = nullptr;
+    const void* hash_tag_ = nullptr;
+};
+
+///
+/// @tparam Node - node type, __list_val<T> or a type derived from it that
+///                carries extra per-node data for the owning container.
+///
+template <typename T, class Alloc = allocator<T>, class Node = __list_val<T>>
+class list : private __alloc_holder<typename Alloc::template rebind<Node>::other> {
    public:
     using iterator = __list_iterator<T, T&, T*>;
     using const_iterator = __list_iterator<T, const T&, const T*>;
     using pointer = typename iterator::pointer;
     using const_pointer = typename const_iterator::pointer;
-    using allocator_type = typename Alloc::template rebind<__list_val<T>>::other;
+    using allocator_type = typename Alloc::template rebind<Node>::other;
+    using node_type = __list_node_handle<Node, allocator_type>;
     using size_type = size_t;
     using value_type = T;
 
    public:
     list() = default;
-    ~list() { clear(); }
+    explicit list(const allocator_type& al) : __alloc_holder<allocator_type>(al) { ; }
+
+    ~list() {
+        clear();
+        set_node_cache_limit(0);
+    }
+
     list(const list& other) = delete;
     list& operator=(const list& other) = delete;
 
     void clear() {
+        if (is_monotonic_allocator_v<allocator_type> && is_trivially_destructible_v<T>) {
+            // nodes are reclaimed with their arena, just forget them
+            _RTL_TRACK_CONTAINER(list, -static_cast<long long>(size_), size_ * sizeof(Node));
+            head_.next = &head_;
+            head_.prev = &head_;
+            size_ = 0;
+            return;
+        }
+
         iterator it = begin();
         while (it != end()) {
             it = erase(it);
         }
     }
 
+    _NODISCARD allocator_type get_allocator() const {
+        return this->get_al();
+    }
+
     _NODISCARD bool empty() const {
         return size() == 0;
     }
@@ -159,12 +295,51 @@ class list {
     iterator erase(iterator pos) {
         iterator tmp = pos++;
         RemoveEntryList(tmp.ptr_);
-        tmp.ptr_->~__list_val();
-        allocator_type().deallocate(tmp.ptr_, 0);
+        Node* node = static_cast<Node*>(tmp.ptr_);
+        node->~Node();
+        free_node(node);
         size_--;
         return pos;
     }
 
+    /// @brief unlink the element at pos, handing its node to the caller
+    node_type extract(iterator pos) {
+        RemoveEntryList(pos.ptr_);
+        size_--;
+        return node_type(static_cast<Node*>(pos.ptr_), this->get_al());
+    }
+
+    /// @brief link the node of nh before pos, without allocating. The node
+    /// must come from a list with an equal allocator.
+    /// @return iterator to the inserted element, end() if nh is empty
+    iterator insert(iterator pos, node_type&& nh) {
+        if (nh.empty()) {
+            return end();
+        }
+
+        Node* node = nh.release();
+        InsertTailList(pos.ptr_, node);
+        size_++;
+        return iterator(node);
+    }
+
+    /// @brief keep up to limit erased nodes for reuse by later insertions
+    /// (default 0, no cache); lowering the limit frees the excess
+    void set_node_cache_limit(size_type limit) {
+        free_limit_ = limit;
+        while (free_count_ > free_limit_) {
+            ListEntry* entry = free_nodes_;
+            free_nodes_ = entry->next;
+            free_count_--;
+            this->get_al().deallocate(reinterpret_cast<Node*>(entry), 1);
+            _RTL_TRACK_CONTAINER(list, -1, sizeof(Node));
+        }
+    }
+
+    _NODISCARD size_type node_cache_limit() const {
+        return free_limit_;
+    }
+
     void splice(iterator where, list& right, iterator first, iterator last) {
         if (first != last && (this != &right || where != last || where != first)) {
             size_type count = 0;
@@ -184,22 +359,52 @@ class list {
 
     template <typename... _Valty>
     void emplace_front(_Valty&&... val) {
-        emplace(begin(), val...);
+        emplace(begin(), rtl::forward<_Valty>(val)...);
     }
 
     template <typename... _Valty>
     void emplace_back(_Valty&&... val) {
-        emplace(end(), val...);
+        emplace(end(), rtl::forward<_Valty>(val)...);
     }
 
-   private:
+    /// @brief construct an element in place before pos
+    /// @return iterator to the new element
     template <typename... _Valty>
-    void emplace(iterator pos, _Valty&&... val) {
-        __list_val<T>* node = allocator_type().allocate(1);
-        assert(node);
-        new (node) __list_val<T>(val...);
+    iterator emplace(iterator pos, _Valty&&... val) {
+        Node* node = allocate_node();
+        new (node) Node(rtl::forward<_Valty>(val)...);
         InsertTailList(pos.ptr_, node);
         size_++;
+        return iterator(node);
+    }
+
+   private:
+    Node* allocate_node() {
+        if (free_nodes_) {
+            ListEntry* entry = free_nodes_;
+            free_nodes_ = entry->next;
+            free_count_--;
+            return reinterpret_cast<Node*>(entry);
+        }
+
+        Node* node = this->get_al().allocate(1);
+        assert(node);
+        _RTL_TRACK_CONTAINER(list, 1, sizeof(Node));
+        return node;
+    }
+
+    /// @brief storage of a destroyed node, to the cache or the allocator
+    void free_node(Node* node) {
+        if (free_count_ < free_limit_) {
+            ListEntry* entry = reinterpret_cast<ListEntry*>(node);
+            entry->next = free_nodes_;
+            free_nodes_ = entry;
+            free_count_++;
+            return;
+        }
+
+        this->get_al().deallocate(node, 1);
+        _RTL_TRACK_CONTAINER(list, -1, sizeof(Node));
     }
 
     void splice(iterator where, list& right, iterator first, iterator last, size_type count) {
@@ -225,6 +430,10 @@ class list {
    private:
     ListEntry head_ = {};  //< Head
     size_type size_ = 0;
+
+    ListEntry* free_nodes_ = nullptr;  //< erased nodes kept for reuse, linked through next
+    size_type free_count_ = 0;
+    size_type free_limit_ = 0;
 };
 
 }  // namespace rtl
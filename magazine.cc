@@ -0,0 +1,326 @@
+#include "magazine.h"
+
+#include <string.h>
+
+#include "slab.h"
+#include "sync.h"
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+#endif
+
+namespace {
+
+struct Magazine {
+    Magazine* next;
+    size_t rounds;
+    void* round[rtl::kMagazineRounds];
+};
+
+struct CpuCache {
+    Magazine* loaded;
+    Magazine* previous;
+};
+
+struct Depot {
+    rtl::spin_lock lock;
+    Magazine* full = nullptr;
+    Magazine* empty = nullptr;
+    size_t full_count = 0;
+    size_t empty_count = 0;
+};
+
+Depot depot[kPoolTagCount][rtl::kSlabClasses];
+
+Magazine* AllocateMagazine() {
+    Magazine* mag = static_cast<Magazine*>(::operator new(sizeof(Magazine), PoolTag::NonPaged));
+    if (mag) {
+        mag->next = nullptr;
+        mag->rounds = 0;
+    }
+    return mag;
+}
+
+void DrainMagazine(Magazine* mag, size_t cls, PoolTag tag) {
+    while (mag->rounds) {
+        rtl::slab_release(mag->round[--mag->rounds], cls, tag);
+    }
+}
+
+Magazine* PopFull(Depot& d) {
+    rtl::lock_guard<rtl::spin_lock> guard(d.lock);
+    Magazine* mag = d.full;
+    if (mag) {
+        d.full = mag->next;
+        d.full_count--;
+    }
+    return mag;
+}
+
+Magazine* PopEmpty(Depot& d) {
+    rtl::lock_guard<rtl::spin_lock> guard(d.lock);
+    Magazine* mag = d.empty;
+    if (mag) {
+        d.empty = mag->next;
+        d.empty_count--;
+    }
+    return mag;
+}
+
+/// @return false if the depot already holds enough full magazines
+bool PushFull(Depot& d, Magazine* mag) {
+    rtl::lock_guard<rtl::spin_lock> guard(d.lock);
+    if (d.full_count >= rtl::kDepotMagazines) {
+        return false;
+    }
+    mag->next = d.full;
+    d.full = mag;
+    d.full_count++;
+    return true;
+}
+
+/// @return false if the depot already holds enough empty magazines
+bool PushEmpty(Depot& d, Magazine* mag) {
+    rtl::lock_guard<rtl::spin_lock> guard(d.lock);
+    if (d.empty_count >= rtl::kDepotMagazines) {
+        return false;
+    }
+    mag->next = d.empty;
+    d.empty = mag;
+    d.empty_count++;
+    return true;
+}
+
+void* CachePop(CpuCache& cache, Depot& d, Magazine** spare) {
+    if (cache.loaded && cache.loaded->rounds) {
+        return cache.loaded->round[--cache.loaded->rounds];
+    }
+
+    if (cache.previous && cache.previous->rounds) {
+        Magazine* tmp = cache.loaded;
+        cache.loaded = cache.previous;
+        cache.previous = tmp;
+        return cache.loaded->round[--cache.loaded->rounds];
+    }
+
+    // both empty, exchange one of them for a full magazine
+    Magazine* full = PopFull(d);
+    if (full == nullptr) {
+        return nullptr;
+    }
+
+    *spare = cache.previous;
+    cache.previous = cache.loaded;
+    cache.loaded = full;
+    return cache.loaded->round[--cache.loaded->rounds];
+}
+
+bool CachePush(CpuCache& cache, Depot& d, void* p, Magazine** drain) {
+    if (cache.loaded && cache.loaded->rounds < rtl::kMagazineRounds) {
+        cache.loaded->round[cache.loaded->rounds++] = p;
+        return true;
+    }
+
+    if (cache.previous && cache.previous->rounds < rtl::kMagazineRounds) {
+        Magazine* tmp = cache.loaded;
+        cache.loaded = cache.previous;
+        cache.previous = tmp;
+        cache.loaded->round[cache.loaded->rounds++] = p;
+        return true;
+    }
+
+    // both full, hand one to the depot and continue with an empty magazine
+    Magazine* empty = PopEmpty(d);
+    if (empty == nullptr) {
+        empty = AllocateMagazine();
+        if (empty == nullptr) {
+            return false;
+        }
+    }
+
+    if (cache.previous && !PushFull(d, cache.previous)) {
+        *drain = cache.previous;
+    }
+    cache.previous = cache.loaded;
+    cache.loaded = empty;
+    cache.loaded->round[cache.loaded->rounds++] = p;
+    return true;
+}
+
+/// @brief give a magazine taken off a cache back to the depot or the pool
+void RetireMagazine(Magazine* mag, size_t cls, PoolTag tag) {
+    if (mag) {
+        DrainMagazine(mag, cls, tag);
+        if (!PushEmpty(depot[static_cast<size_t>(tag)][cls], mag)) {
+            ::operator delete(mag, PoolTag::NonPaged);
+        }
+    }
+}
+
+void FlushCache(CpuCache& cache, size_t cls, PoolTag tag) {
+    RetireMagazine(cache.loaded, cls, tag);
+    RetireMagazine(cache.previous, cls, tag);
+    cache.loaded = nullptr;
+    cache.previous = nullptr;
+}
+
+void FlushDepots() {
+    for (size_t t = 0; t < kPoolTagCount; t++) {
+        for (size_t c = 0; c < rtl::kSlabClasses; c++) {
+            Depot& d = depot[t][c];
+            for (Magazine* mag = PopFull(d); mag; mag = PopFull(d)) {
+                DrainMagazine(mag, c, static_cast<PoolTag>(t));
+                ::operator delete(mag, PoolTag::NonPaged);
+            }
+            for (Magazine* mag = PopEmpty(d); mag; mag = PopEmpty(d)) {
+                ::operator delete(mag, PoolTag::NonPaged);
+            }
+        }
+    }
+}
+
+struct CpuCaches {
+    CpuCache cache[kPoolTagCount][rtl::kSlabClasses];
+};
+
+}  // namespace
+
+#if defined(_WIN32) && defined(_KRTL)
+
+//
+// The caches are indexed by processor number, DISPATCH_LEVEL keeps the
+// thread on its processor while it touches them. Blocks themselves may be
+// paged, so they are only released to the slab after lowering IRQL again.
+//
+static CpuCaches* caches = nullptr;
+static ULONG cpu_count = 0;
+
+bool rtl::magazine_initialize() {
+    if (caches) {
+        return true;
+    }
+
+    ULONG count = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    CpuCaches* tmp = static_cast<CpuCaches*>(::operator new(count * sizeof(CpuCaches), PoolTag::NonPaged));
+    if (tmp == nullptr) {
+        return false;
+    }
+    memset(tmp, 0, count * sizeof(CpuCaches));
+    cpu_count = count;
+    caches = tmp;
+    return true;
+}
+
+void rtl::magazine_uninitialize() {
+    if (caches) {
+        for (ULONG i = 0; i < cpu_count; i++) {
+            for (size_t t = 0; t < kPoolTagCount; t++) {
+                for (size_t c = 0; c < kSlabClasses; c++) {
+                    FlushCache(caches[i].cache[t][c], c, static_cast<PoolTag>(t));
+                }
+            }
+        }
+        FlushDepots();
+        ::operator delete(caches, PoolTag::NonPaged);
+        caches = nullptr;
+        cpu_count = 0;
+    }
+}
+
+static CpuCache& CurrentCache(size_t cls, PoolTag tag) {
+    ULONG cpu = KeGetCurrentProcessorNumberEx(nullptr) % cpu_count;
+    return caches[cpu].cache[static_cast<size_t>(tag)][cls];
+}
+
+void* rtl::magazine_allocate(size_t cls, PoolTag tag) {
+    if (caches == nullptr) {
+        return nullptr;
+    }
+
+    Magazine* spare = nullptr;
+    KIRQL irql = KeRaiseIrqlToDpcLevel();
+    void* p = CachePop(CurrentCache(cls, tag), depot[static_cast<size_t>(tag)][cls], &spare);
+    KeLowerIrql(irql);
+
+    RetireMagazine(spare, cls, tag);
+    return p;
+}
+
+bool rtl::magazine_deallocate(void* p, size_t cls, PoolTag tag) {
+    if (caches == nullptr) {
+        return false;
+    }
+
+    Magazine* drain = nullptr;
+    KIRQL irql = KeRaiseIrqlToDpcLevel();
+    bool cached = CachePush(CurrentCache(cls, tag), depot[static_cast<size_t>(tag)][cls], p, &drain);
+    KeLowerIrql(irql);
+
+    RetireMagazine(drain, cls, tag);
+    return cached;
+}
+
+#else
+
+//
+// User mode caches per thread instead of per CPU, a thread flushes its
+// magazines when it exits.
+//
+static bool initialized = false;
+
+struct ThreadCaches : CpuCaches {
+    ThreadCaches() { memset(cache, 0, sizeof(cache)); }
+    ~ThreadCaches() {
+        flush();
+        if (!initialized) {
+            FlushDepots();
+        }
+    }
+
+    void flush() {
+        for (size_t t = 0; t < kPoolTagCount; t++) {
+            for (size_t c = 0; c < rtl::kSlabClasses; c++) {
+                FlushCache(cache[t][c], c, static_cast<PoolTag>(t));
+            }
+        }
+    }
+};
+
+static thread_local ThreadCaches caches;
+
+bool rtl::magazine_initialize() {
+    initialized = true;
+    return true;
+}
+
+void rtl::magazine_uninitialize() {
+    if (initialized) {
+        initialized = false;
+        caches.flush();
+        FlushDepots();
+    }
+}
+
+void* rtl::magazine_allocate(size_t cls, PoolTag tag) {
+    if (!initialized) {
+        return nullptr;
+    }
+
+    Magazine* spare = nullptr;
+    void* p = CachePop(caches.cache[static_cast<size_t>(tag)][cls], depot[static_cast<size_t>(tag)][cls], &spare);
+    RetireMagazine(spare, cls, tag);
+    return p;
+}
+
+bool rtl::magazine_deallocate(void* p, size_t cls, PoolTag tag) {
+    if (!initialized) {
+        return false;
+    }
+
+    Magazine* drain = nullptr;
+    bool cached = CachePush(caches.cache[static_cast<size_t>(tag)][cls], depot[static_cast<size_t>(tag)][cls], p, &drain);
+    RetireMagazine(drain, cls, tag);
+    return cached;
+}
+
+#endif
\ No newline at end of file
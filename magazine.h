@@ -0,0 +1,37 @@
+/// @file Per-CPU magazine caches in front of the slab lookaside lists
+#ifndef _MAGAZINE_H
+#define _MAGAZINE_H
+
+#include <cstddef>
+
+#include "new.h"
+
+namespace rtl {
+
+//
+// Each CPU (each thread in user mode) keeps two magazines of kMagazineRounds
+// blocks per (PoolTag, size class). Allocation and free touch only the local
+// magazines; whole magazines are exchanged with a shared depot when both are
+// empty or full, and the depot drains batches back to the slab when it holds
+// more than kDepotMagazines full ones.
+//
+constexpr size_t kMagazineRounds = 32;
+constexpr size_t kDepotMagazines = 16;
+
+bool magazine_initialize();
+
+/// @brief flush every cache and the depot back to the slab
+void magazine_uninitialize();
+
+/// @return a cached block of size class cls, nullptr on miss
+void* magazine_allocate(size_t cls, PoolTag tag);
+
+/// @return true if the block was cached, false if the caller must free it
+bool magazine_deallocate(void* p, size_t cls, PoolTag tag);
+
+/// @brief hand a block back to the lookaside list (implemented in slab.cc)
+void slab_release(void* p, size_t cls, PoolTag tag) noexcept;
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -2,11 +2,21 @@
 #define _MEMORY_HPP
 
 #include <cstddef>
+#include <string.h>
 
+#include "common.h"
 #include "new.h"
+#include "slab.h"
+#include "telemetry.h"
 
 namespace rtl {
-template <typename T, PoolTag Tag = PoolTag::NonPaged>
+
+///
+/// Pool allocator. Blocks are aligned to alignof(T), or to Align if that is
+/// stronger; Align carries over through rebind so list nodes and bucket
+/// tables of a container get the same treatment as its elements.
+///
+template <typename T, PoolTag Tag = PoolTag::NonPaged, size_t Align = 0>
 class allocator {
    public:
     using value_type = T;
@@ -17,31 +27,175 @@ class allocator {
     using size_type = size_t;
     using difference_type = ptrdiff_t;
 
+    static constexpr size_t alignment = Align > alignof(T) ? Align : alignof(T);
+
     template <typename U>
     struct rebind {
-        using other = allocator<U, Tag>;
+        using other = allocator<U, Tag, Align>;
     };
 
     allocator() = default;
     ~allocator() = default;
 
     template <typename U>
-    allocator(const allocator<U, Tag>&) {}
+    allocator(const allocator<U, Tag, Align>&) {}
 
     T* allocate(size_t n) const {
-        return static_cast<T*>(::operator new(n * sizeof(T), Tag));
+#if _KRTL_TELEMETRY
+        return static_cast<T*>(telemetry_allocate(n * sizeof(T), Tag, alignment));
+#else
+        return static_cast<T*>(slab_allocate(n * sizeof(T), Tag, alignment));
+#endif
     }
 
-    void deallocate(T* p, size_t) const {
-        ::operator delete(p, Tag);
+    /// @param n - same count as passed to allocate (selects the size class)
+    void deallocate(T* p, size_t n) const {
+#if _KRTL_TELEMETRY
+        telemetry_deallocate(p, n * sizeof(T), Tag, alignment);
+#else
+        slab_deallocate(p, n * sizeof(T), Tag, alignment);
+#endif
     }
 };
 
+///
+/// Allocator starting every block on its own cache line, for data written
+/// from several CPUs (pair it with alignas(kCacheLineSize) elements to keep
+/// them apart from each other as well).
+///
+template <typename T, PoolTag Tag = PoolTag::NonPaged>
+using cache_aligned_allocator = allocator<T, Tag, kCacheLineSize>;
+
+//
+// Allocators whose deallocate() is a no-op because the memory is reclaimed
+// in bulk by its owner (see arena.h). Containers skip per-element teardown
+// for them when the elements are trivially destructible.
+//
+template <typename Alloc>
+struct is_monotonic_allocator : false_type {};
+
+template <typename Alloc>
+constexpr bool is_monotonic_allocator_v = is_monotonic_allocator<Alloc>::value;
+
+//
+// Allocator instance kept by a container, stateless allocators are stored
+// as an empty base so they add nothing to the container size.
+//
+template <typename Alloc, bool = is_empty_v<Alloc> && !is_final_v<Alloc>>
+class __alloc_holder : private Alloc {
+   public:
+    __alloc_holder() = default;
+    __alloc_holder(const Alloc& al) : Alloc(al) { ; }
+
+    Alloc& get_al() { return *this; }
+    const Alloc& get_al() const { return *this; }
+};
+
+template <typename Alloc>
+class __alloc_holder<Alloc, false> {
+   public:
+    __alloc_holder() = default;
+    __alloc_holder(const Alloc& al) : al_(al) { ; }
+
+    Alloc& get_al() { return al_; }
+    const Alloc& get_al() const { return al_; }
+
+   private:
+    Alloc al_;
+};
+
+//
+// Move [first, last) to uninitialized dest and end the lifetime of the
+// source, with a single memmove for trivially relocatable types. dest may
+// overlap the source when it lies below first.
+//
+template <typename T>
+void __relocate(T* first, T* last, T* dest) {
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (first != last) {
+            memmove(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+        }
+    } else {
+        for (; first != last; ++first, ++dest) {
+            new (dest) T(rtl::move(*first));
+            first->~T();
+        }
+    }
+}
+
+//
+// As __relocate, walking backwards so that dest may overlap the source
+// above first (shifting elements up within one buffer).
+//
+template <typename T>
+void __relocate_backward(T* first, T* last, T* dest) {
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (first != last) {
+            memmove(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+        }
+    } else {
+        for (dest += last - first; first != last;) {
+            new (--dest) T(rtl::move(*--last));
+            last->~T();
+        }
+    }
+}
+
+//
+// Copy construct [first, last) into uninitialized dest, a single memcpy when
+// copying from a T array of trivially copyable type.
+//
+template <typename Iter, typename T>
+T* __uninitialized_copy(Iter first, Iter last, T* dest) {
+    for (; first != last; ++first, ++dest) {
+        new (dest) T(*first);
+    }
+    return dest;
+}
+
+template <typename U, typename T>
+T* __uninitialized_copy(U* first, U* last, T* dest) {
+    if constexpr (is_same_v<remove_cv_t<U>, T> && is_trivially_copyable_v<T>) {
+        if (first != last) {
+            memcpy(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+        }
+        return dest + (last - first);
+    } else {
+        for (; first != last; ++first, ++dest) {
+            new (dest) T(*first);
+        }
+        return dest;
+    }
+}
+
+template <typename T>
+void __destroy(T* first, T* last) {
+    if constexpr (!is_trivially_destructible_v<T>) {
+        for (; first != last; ++first) {
+            first->~T();
+        }
+    }
+}
+
+template <typename Iter>
+size_t __distance(Iter first, Iter last) {
+    size_t n = 0;
+    for (; first != last; ++first) {
+        n++;
+    }
+    return n;
+}
+
+template <typename T>
+size_t __distance(T* first, T* last) {
+    return last - first;
+}
+
 template <typename Alloc>
 struct pool_tag;
 
-template <typename T, PoolTag tag>
-struct pool_tag<allocator<T, tag>> {
+template <typename T, PoolTag tag, size_t align>
+struct pool_tag<allocator<T, tag, align>> {
     static constexpr PoolTag value = tag;
 };
 
@@ -135,4 +135,43 @@ void __cdecl operator delete(void* p, PoolTag) noexcept {
 
 void __cdecl operator delete[](void* p, PoolTag) noexcept {
     ::operator delete(p);
+}
+
+//
+// aligned allocation: blocks stronger aligned than the pool are carved out
+// of a larger block, the pointer to which is kept just below the result
+//
+void* __cdecl operator new(size_t n, align_val_t align, PoolTag tag) noexcept {
+    size_t a = static_cast<size_t>(align);
+    if (a <= kPoolAlignment) {
+        return ::operator new(n, tag);
+    }
+
+    char* raw = static_cast<char*>(::operator new(n + a + sizeof(void*), tag));
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    char* p = reinterpret_cast<char*>((reinterpret_cast<size_t>(raw) + sizeof(void*) + a - 1) & ~(a - 1));
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return p;
+}
+
+void* __cdecl operator new[](size_t n, align_val_t align, PoolTag tag) noexcept {
+    return ::operator new(n, align, tag);
+}
+
+void __cdecl operator delete(void* p, align_val_t align, PoolTag tag) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    if (static_cast<size_t>(align) <= kPoolAlignment) {
+        ::operator delete(p, tag);
+    } else {
+        ::operator delete(reinterpret_cast<void**>(p)[-1], tag);
+    }
+}
+
+void __cdecl operator delete[](void* p, align_val_t align, PoolTag tag) noexcept {
+    ::operator delete(p, align, tag);
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 
 #include <cstddef>
 
+#if !defined(_MSC_VER) && !defined(__cdecl)
+#define __cdecl
+#endif
+
 enum class PoolTag {
     Paged,
     NonPaged,
@@ -10,13 +14,29 @@ enum class PoolTag {
     NonPagedNx,
 };
 
+constexpr size_t kPoolTagCount = 4;  // number of PoolTag values
+
+// alignment of every pool (and malloc) block, MEMORY_ALLOCATION_ALIGNMENT
+constexpr size_t kPoolAlignment = 2 * sizeof(void*);
+constexpr size_t kCacheLineSize = 64;
+
+enum class align_val_t : size_t {};
+
 // allocation new
 void* __cdecl operator new(size_t n, PoolTag tag);
 void* __cdecl operator new[](size_t n, PoolTag tag);
 
-// placement new
+// aligned allocation new (align must be a power of 2), nullptr when out of memory
+void* __cdecl operator new(size_t n, align_val_t align, PoolTag tag) noexcept;
+void* __cdecl operator new[](size_t n, align_val_t align, PoolTag tag) noexcept;
+
+// placement new: kernel mode has no <new>, user mode must not redefine its reserved forms
+#if defined(_WIN32) && defined(_KRTL)
 void* __cdecl operator new(size_t, void* p) noexcept;
 void* __cdecl operator new[](size_t, void* p) noexcept;
+#else
+#include <new>
+#endif
 
 void assert(void* p);
 
@@ -25,6 +45,8 @@ void assert(void* p);
 //
 void __cdecl operator delete(void* p, PoolTag) noexcept;
 void __cdecl operator delete[](void* p, PoolTag) noexcept;
+void __cdecl operator delete(void* p, align_val_t align, PoolTag tag) noexcept;
+void __cdecl operator delete[](void* p, align_val_t align, PoolTag tag) noexcept;
 void __cdecl operator delete(void* p) noexcept;
 void __cdecl operator delete[](void* p) noexcept;
 void __cdecl operator delete(void* p, size_t) noexcept;
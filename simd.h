@@ -0,0 +1,54 @@
+/// @file SSE2 availability, bit scanning and prefetch helpers
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//
+// _RTL_SSE2 is defined when SSE2 may be used unconditionally: always on x64
+// (kernel code included), on x86 only when the compiler targets it.
+//
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _RTL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// countr_zero
+//
+/// @brief index of the lowest set bit, mask must not be 0
+inline unsigned countr_zero(unsigned mask) noexcept {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// prefetch
+//
+/// @brief hint that the cache line holding p is about to be read
+inline void prefetch(const void* p) noexcept {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __prefetch(p);
+#else
+    __builtin_prefetch(p);
+#endif
+}
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "slab.h"
+
+#include "magazine.h"
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+
+static constexpr ULONG slab_tag = 'nltr';
+
+static LOOKASIDE_LIST_EX lookaside[kPoolTagCount][rtl::kSlabClasses];
+static bool initialized = false;
+
+static POOL_TYPE Tag2PoolType(PoolTag tag) {
+    switch (tag) {
+        case PoolTag::Paged:
+            return PagedPool;
+        case PoolTag::NonPaged:
+            return NonPagedPool;
+        case PoolTag::NonPagedExecute:
+            return NonPagedPoolExecute;
+        case PoolTag::NonPagedNx:
+            return NonPagedPoolNx;
+        default:
+            return PagedPool;
+    }
+}
+
+static void DeleteLookasideLists(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        ExDeleteLookasideListEx(&lookaside[i / rtl::kSlabClasses][i % rtl::kSlabClasses]);
+    }
+}
+
+bool rtl::slab_initialize(bool magazines) {
+    if (initialized) {
+        return true;
+    }
+
+    for (size_t t = 0; t < kPoolTagCount; t++) {
+        for (size_t c = 0; c < kSlabClasses; c++) {
+            NTSTATUS status = ExInitializeLookasideListEx(&lookaside[t][c], nullptr, nullptr,
+                                                          Tag2PoolType(static_cast<PoolTag>(t)),
+                                                          0, slab_class_size(c), slab_tag, 0);
+            if (!NT_SUCCESS(status)) {
+                DeleteLookasideLists(t * kSlabClasses + c);
+                return false;
+            }
+        }
+    }
+    initialized = true;
+    if (magazines && !magazine_initialize()) {
+        slab_uninitialize();
+        return false;
+    }
+    return true;
+}
+
+void rtl::slab_uninitialize() {
+    if (initialized) {
+        magazine_uninitialize();
+        initialized = false;
+        DeleteLookasideLists(kPoolTagCount * kSlabClasses);
+    }
+}
+
+void* rtl::slab_allocate(size_t n, PoolTag tag) {
+    if (n == 0 || n > kSlabMaxSize) {
+        return ::operator new(n, tag);
+    }
+
+    // always hand out full class-size blocks so they can go to the list later
+    size_t cls = slab_class(n);
+    if (!initialized) {
+        return ::operator new(slab_class_size(cls), tag);
+    }
+
+    void* p = magazine_allocate(cls, tag);
+    if (p == nullptr) {
+        p = ExAllocateFromLookasideListEx(&lookaside[static_cast<size_t>(tag)][cls]);
+    }
+    return p;
+}
+
+void rtl::slab_deallocate(void* p, size_t n, PoolTag tag) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    if (!initialized || n == 0 || n > kSlabMaxSize) {
+        ::operator delete(p, tag);
+    } else if (!magazine_deallocate(p, slab_class(n), tag)) {
+        slab_release(p, slab_class(n), tag);
+    }
+}
+
+void rtl::slab_release(void* p, size_t cls, PoolTag tag) noexcept {
+    if (initialized) {
+        ExFreeToLookasideListEx(&lookaside[static_cast<size_t>(tag)][cls], p);
+    } else {
+        ::operator delete(p, tag);
+    }
+}
+
+#else
+#include "sync.h"
+
+//
+// User mode mirrors LOOKASIDE_LIST_EX: freed blocks are kept on a bounded
+// singly linked list and handed back before asking malloc for a new one.
+//
+struct Lookaside {
+    struct Block {
+        Block* next;
+    };
+
+    rtl::spin_lock lock;
+    Block* head = nullptr;
+    size_t depth = 0;
+};
+
+static constexpr size_t kLookasideDepth = 256;
+
+static Lookaside lookaside[kPoolTagCount][rtl::kSlabClasses];
+static bool initialized = false;
+
+bool rtl::slab_initialize(bool magazines) {
+    initialized = true;
+    if (magazines && !magazine_initialize()) {
+        slab_uninitialize();
+        return false;
+    }
+    return true;
+}
+
+void rtl::slab_uninitialize() {
+    if (!initialized) {
+        return;
+    }
+
+    magazine_uninitialize();
+    initialized = false;
+    for (auto& lists : lookaside) {
+        for (auto& list : lists) {
+            rtl::lock_guard<rtl::spin_lock> guard(list.lock);
+            while (list.head) {
+                Lookaside::Block* block = list.head;
+                list.head = block->next;
+                ::operator delete(block);
+            }
+            list.depth = 0;
+        }
+    }
+}
+
+void* rtl::slab_allocate(size_t n, PoolTag tag) {
+    if (n == 0 || n > kSlabMaxSize) {
+        return ::operator new(n, tag);
+    }
+
+    // always hand out full class-size blocks so they can go to the list later
+    size_t cls = slab_class(n);
+    if (!initialized) {
+        return ::operator new(slab_class_size(cls), tag);
+    }
+
+    void* p = magazine_allocate(cls, tag);
+    if (p) {
+        return p;
+    }
+
+    Lookaside& list = lookaside[static_cast<size_t>(tag)][cls];
+    {
+        rtl::lock_guard<rtl::spin_lock> guard(list.lock);
+        Lookaside::Block* block = list.head;
+        if (block) {
+            list.head = block->next;
+            list.depth--;
+            return block;
+        }
+    }
+    return ::operator new(slab_class_size(cls), tag);
+}
+
+void rtl::slab_deallocate(void* p, size_t n, PoolTag tag) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    if (!initialized || n == 0 || n > kSlabMaxSize) {
+        ::operator delete(p, tag);
+    } else if (!magazine_deallocate(p, slab_class(n), tag)) {
+        slab_release(p, slab_class(n), tag);
+    }
+}
+
+void rtl::slab_release(void* p, size_t cls, PoolTag tag) noexcept {
+    if (!initialized) {
+        ::operator delete(p, tag);
+        return;
+    }
+
+    Lookaside& list = lookaside[static_cast<size_t>(tag)][cls];
+    {
+        rtl::lock_guard<rtl::spin_lock> guard(list.lock);
+        if (list.depth < kLookasideDepth) {
+            Lookaside::Block* block = static_cast<Lookaside::Block*>(p);
+            block->next = list.head;
+            list.head = block;
+            list.depth++;
+            return;
+        }
+    }
+    ::operator delete(p, tag);
+}
+
+#endif
\ No newline at end of file
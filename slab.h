@@ -0,0 +1,62 @@
+/// @file Size-class slab allocator (lookaside lists per PoolTag)
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <cstddef>
+
+#include "new.h"
+
+namespace rtl {
+
+//
+// Requests up to kSlabMaxSize bytes are rounded up to a multiple of
+// kSlabGranularity and served from a lookaside list of fixed-size blocks,
+// one list per (PoolTag, size class). Larger requests go to the pool.
+//
+constexpr size_t kSlabGranularity = 16;
+constexpr size_t kSlabMaxSize = 512;
+constexpr size_t kSlabClasses = kSlabMaxSize / kSlabGranularity;
+
+/// @brief index of the size class serving n bytes (0 < n <= kSlabMaxSize)
+constexpr size_t slab_class(size_t n) {
+    return (n + kSlabGranularity - 1) / kSlabGranularity - 1;
+}
+
+/// @brief block size of a size class
+constexpr size_t slab_class_size(size_t cls) {
+    return (cls + 1) * kSlabGranularity;
+}
+
+/// @brief create the lookaside lists, call once before the first allocation
+/// (e.g. from DriverEntry). Until then every request goes to the pool.
+/// @param magazines - put per-CPU magazine caches in front of the lists
+bool slab_initialize(bool magazines = true);
+
+/// @brief release all cached blocks, call after the last deallocation
+void slab_uninitialize();
+
+/// @brief allocate n bytes from the size class of n, or from the pool
+void* slab_allocate(size_t n, PoolTag tag);
+
+/// @brief return a block, n and tag must match the allocating call
+void slab_deallocate(void* p, size_t n, PoolTag tag) noexcept;
+
+/// @brief as above, blocks aligned stronger than the pool bypass the slab
+inline void* slab_allocate(size_t n, PoolTag tag, size_t align) {
+    if (align > kPoolAlignment) {
+        return ::operator new(n, static_cast<align_val_t>(align), tag);
+    }
+    return slab_allocate(n, tag);
+}
+
+inline void slab_deallocate(void* p, size_t n, PoolTag tag, size_t align) noexcept {
+    if (align > kPoolAlignment) {
+        ::operator delete(p, static_cast<align_val_t>(align), tag);
+    } else {
+        slab_deallocate(p, n, tag);
+    }
+}
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+/// @file Vector with inline storage for a small number of elements
+#ifndef _SMALL_VECTOR_H
+#define _SMALL_VECTOR_H
+
+#include "vector.h"
+
+namespace rtl {
+
+///
+/// Same interface as vector, but the first N elements live inside the
+/// object itself: up to N elements no pool allocation is made, beyond that
+/// the elements move to a heap buffer growing like vector's. shrink_to_fit()
+/// moves them back inline once they fit again.
+///
+template <class T, size_t N, class Alloc = allocator<T>>
+class small_vector : public __vector_impl<T, Alloc, N> {
+    static_assert(N > 0, "use vector for N == 0");
+
+   public:
+    using __vector_impl<T, Alloc, N>::__vector_impl;
+
+    small_vector() = default;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
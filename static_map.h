@@ -0,0 +1,231 @@
+/// @file Perfect hash tables built at compile time
+#ifndef _STATIC_MAP_H
+#define _STATIC_MAP_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "hash.h"
+#include "string.h"
+
+namespace rtl {
+
+template <class K, class V>
+struct static_map_entry {
+    K first = K();
+    V second = V();
+};
+
+//
+// Key types static_map supports: integers and basic_string_view. Tables are
+// built from build_hash (constexpr) and searched with hash, the run time
+// function giving the same value.
+//
+template <class K>
+struct __static_key {
+    static_assert(is_integral_v<K>, "static_map keys are integers or basic_string_view");
+
+    static constexpr uint64_t build_hash(K key) { return _Hash_integer_constexpr(static_cast<uint64_t>(key)); }
+
+    static uint64_t hash(K key) { return _Hash_integer(static_cast<uint64_t>(key)); }
+
+    static constexpr bool build_equal(K x, K y) { return x == y; }
+};
+
+template <class T>
+struct __static_key<basic_string_view<T>> {
+    static constexpr uint64_t build_hash(basic_string_view<T> key) {
+        return _Hash_bytes_constexpr(key.data(), key.size() * sizeof(T));
+    }
+
+    static uint64_t hash(basic_string_view<T> key) { return _Hash_bytes(key.data(), key.size() * sizeof(T)); }
+
+    static constexpr bool build_equal(basic_string_view<T> x, basic_string_view<T> y) {
+        if (x.size() != y.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < x.size(); i++) {
+            if (x[i] != y[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Not constexpr on purpose: reaching either while building a constexpr
+// static_map stops the compilation at the offending table.
+inline void __static_map_duplicate_key() { ; }
+inline void __static_map_no_seed() { ; }
+
+//////////////////////////////////////////////////////////////////////////
+//
+// static_map
+//
+
+///
+/// Immutable map over a key list fixed at compile time, for keyword and
+/// command tables. The constructor runs the hash-and-displace construction:
+/// keys are split into buckets by their hash, and each bucket gets a seed
+/// under which its keys land on free slots. A lookup is one hash, one seed
+/// and slot load, and one key compare; nothing is built or allocated at run
+/// time when the map is declared constexpr:
+///
+///   constexpr auto kCommands = rtl::make_static_map<rtl::string_view, int>({
+///       {"open", 1},
+///       {"close", 2},
+///   });
+///
+/// Duplicate keys make a constexpr declaration fail to compile.
+///
+/// @tparam K - integral type or basic_string_view.
+/// @tparam N - number of entries.
+///
+template <class K, class V, size_t N>
+class static_map {
+    static_assert(N > 0 && N < UINT32_MAX, "static_map holds 1 to 2^32 - 2 entries");
+
+   public:
+    using value_type = static_map_entry<K, V>;
+    using size_type = size_t;
+    using const_iterator = const value_type*;
+
+    constexpr explicit static_map(const value_type (&items)[N]) : items_(), seeds_(), slots_() {
+        for (size_t i = 0; i < N; i++) {
+            items_[i] = items[i];
+        }
+        build();
+    }
+
+    /// @return the entry of key, or end()
+    const_iterator find(const K& key) const {
+        uint64_t h = __static_key<K>::hash(key);
+        uint32_t i = slots_[slot_of(h, seeds_[h & (kBuckets - 1)])];
+        return i != kEmpty && items_[i].first == key ? items_ + i : end();
+    }
+
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    /// @brief entries in the order given to the constructor
+    constexpr const_iterator begin() const { return items_; }
+
+    constexpr const_iterator end() const { return items_ + N; }
+
+    constexpr size_type size() const { return N; }
+
+   private:
+    static constexpr size_t slots_for(size_t n) {
+        size_t slots = 2;
+        while (slots < 2 * n) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    static constexpr unsigned log2(size_t n) {
+        unsigned bits = 0;
+        while ((size_t(1) << bits) < n) {
+            bits++;
+        }
+        return bits;
+    }
+
+    // slots at most half full, about two keys per bucket
+    static constexpr size_t kSlots = slots_for(N);
+    static constexpr size_t kBuckets = kSlots / 4 ? kSlots / 4 : 1;
+    static constexpr unsigned kShift = 64 - log2(kSlots);
+    static constexpr uint64_t kSlotMultiplier = _Hash_secret[2] | 1;
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    static constexpr uint32_t kMaxSeed = 1u << 16;
+
+    /// @brief top bits of a multiply, every bit of h and seed counts
+    static constexpr size_t slot_of(uint64_t h, uint32_t seed) {
+        return static_cast<size_t>(((h ^ seed) * kSlotMultiplier) >> kShift);
+    }
+
+    constexpr void build() {
+        uint64_t hashes[N] = {};
+        for (size_t i = 0; i < N; i++) {
+            hashes[i] = __static_key<K>::build_hash(items_[i].first);
+        }
+
+        // group the keys by bucket: members of bucket b are order[starts[b], starts[b + 1])
+        size_t starts[kBuckets + 1] = {};
+        size_t order[N] = {};
+        for (size_t i = 0; i < N; i++) {
+            starts[(hashes[i] & (kBuckets - 1)) + 1]++;
+        }
+        for (size_t b = 0; b < kBuckets; b++) {
+            starts[b + 1] += starts[b];
+        }
+        size_t fill[kBuckets] = {};
+        for (size_t i = 0; i < N; i++) {
+            size_t bucket = hashes[i] & (kBuckets - 1);
+            order[starts[bucket] + fill[bucket]++] = i;
+        }
+
+        // equal keys have equal hashes, so duplicates share a bucket
+        size_t largest = 0;
+        for (size_t b = 0; b < kBuckets; b++) {
+            for (size_t i = starts[b]; i < starts[b + 1]; i++) {
+                for (size_t j = starts[b]; j < i; j++) {
+                    if (__static_key<K>::build_equal(items_[order[i]].first, items_[order[j]].first)) {
+                        __static_map_duplicate_key();
+                    }
+                }
+            }
+            largest = fill[b] > largest ? fill[b] : largest;
+        }
+
+        for (size_t s = 0; s < kSlots; s++) {
+            slots_[s] = kEmpty;
+        }
+
+        // largest buckets first, while most slots are still free
+        for (size_t size = largest; size > 0; size--) {
+            for (size_t b = 0; b < kBuckets; b++) {
+                if (fill[b] == size) {
+                    place(b, hashes, order + starts[b], size);
+                }
+            }
+        }
+    }
+
+    /// @brief find a seed putting the keys members[0, count) of bucket on free slots
+    constexpr void place(size_t bucket, const uint64_t (&hashes)[N], const size_t* members, size_t count) {
+        for (uint32_t seed = 0; seed < kMaxSeed; seed++) {
+            size_t placed = 0;
+            for (; placed < count; placed++) {
+                size_t slot = slot_of(hashes[members[placed]], seed);
+                if (slots_[slot] != kEmpty) {
+                    break;  // taken, possibly by a key of this bucket
+                }
+                slots_[slot] = static_cast<uint32_t>(members[placed]);
+            }
+
+            if (placed == count) {
+                seeds_[bucket] = seed;
+                return;
+            }
+            while (placed > 0) {
+                placed--;
+                slots_[slot_of(hashes[members[placed]], seed)] = kEmpty;
+            }
+        }
+        __static_map_no_seed();
+    }
+
+    value_type items_[N];
+    uint32_t seeds_[kBuckets];
+    uint32_t slots_[kSlots];  // index into items_, or kEmpty
+};
+
+/// @brief static_map of the braced entry list items, deducing N
+template <class K, class V, size_t N>
+constexpr static_map<K, V, N> make_static_map(const static_map_entry<K, V> (&items)[N]) {
+    return static_map<K, V, N>(items);
+}
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
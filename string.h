@@ -1,58 +1,214 @@
 /// @file string wrapper
-#ifndef _STRING_H
-#define _STRING_H
+#ifndef _RTL_STRING_H
+#define _RTL_STRING_H
 
 #include <string.h>
 
 #include "common.h"
 #include "hash.h"
 #include "memory.h"
+#include "string_simd.h"
 
 namespace rtl {
 
-template <typename T, class Alloc = allocator<T>>
-class basic_string {
+///
+/// Non-owning pointer + length view of a string, used to look strings up
+/// without building a basic_string. Comparisons and searches run on the
+/// kernels of string_simd.h, so T is char or wchar_t for those.
+///
+template <typename T>
+class basic_string_view {
+   public:
+    using const_pointer = const T*;
+    using const_iterator = const_pointer;
+
+    static constexpr size_t npos = kStrNotFound;
+
+    constexpr basic_string_view() = default;
+
+    constexpr basic_string_view(const_pointer ptr, size_t size) : data_(ptr), size_(size) { ; }
+
+    constexpr basic_string_view(const_pointer ptr) : data_(ptr), size_(length(ptr)) { ; }
+
+    constexpr const_pointer data() const {
+        return data_;
+    }
+
+    constexpr size_t size() const {
+        return size_;
+    }
+
+    constexpr const_iterator begin() const {
+        return data_;
+    }
+
+    constexpr const_iterator end() const {
+        return data_ + size_;
+    }
+
+    constexpr const T& operator[](size_t pos) const {
+        return data_[pos];
+    }
+
+    bool operator==(basic_string_view str) const {
+        return size_ == str.size_ && str_mismatch(data_, str.data_, size_) == size_;
+    }
+
+    bool operator!=(basic_string_view str) const {
+        return !(*this == str);
+    }
+
+    bool operator<(basic_string_view str) const {
+        return compare(str) < 0;
+    }
+
+    /// @return <0, 0 or >0 as this sorts before, equal to or after str
+    int compare(basic_string_view str) const {
+        return str_compare(data_, size_, str.data_, str.size_);
+    }
+
+    /// @brief compare, with ASCII letters matching either case
+    int compare_icase(basic_string_view str) const {
+        return str_compare_icase(data_, size_, str.data_, str.size_);
+    }
+
+    bool equal_icase(basic_string_view str) const {
+        return size_ == str.size_ && str_mismatch_icase(data_, str.data_, size_) == size_;
+    }
+
+    /// @return position of the first c at or after pos, or npos
+    size_t find(T c, size_t pos = 0) const {
+        if (pos >= size_) {
+            return npos;
+        }
+        size_t i = str_find(data_ + pos, size_ - pos, c);
+        return i == npos ? npos : pos + i;
+    }
+
+    /// @return position of the first str at or after pos, or npos
+    size_t find(basic_string_view str, size_t pos = 0) const {
+        if (pos > size_) {
+            return npos;
+        }
+        size_t i = str_find(data_ + pos, size_ - pos, str.data_, str.size_);
+        return i == npos ? npos : pos + i;
+    }
+
+   private:
+    static constexpr size_t length(const T* ptr) {
+        size_t count = 0;
+        while (ptr[count] != T()) {
+            count++;
+        }
+        return count;
+    }
+
+    const_pointer data_ = nullptr;
+    size_t size_ = 0;
+};
+
+using string_view = basic_string_view<char>;
+using wstring_view = basic_string_view<wchar_t>;
+
+/// @brief inline characters of a basic_string representation of bytes bytes
+/// (a leading size byte padded to alignof(T), the characters, the terminator)
+template <typename T>
+constexpr size_t __sso_capacity(size_t bytes) {
+    return (bytes - alignof(T)) / sizeof(T) - 1;
+}
+
+/// @brief bytes of a basic_string representation holding n characters inline
+template <typename T>
+constexpr size_t __sso_bytes(size_t n) {
+    size_t bytes = (alignof(T) + (n + 1) * sizeof(T) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+    return bytes > 3 * sizeof(size_t) ? bytes : 3 * sizeof(size_t);
+}
+
+///
+/// String of T with the small-string optimization laid out as in libc++:
+/// the object is a union of a long form {capacity, size, pointer} and a short
+/// form {size byte, characters}, told apart by the low bit of the first byte
+/// (the long capacity is stored shifted left with that bit set, the short
+/// size shifted left with it clear). This relies on a little-endian target.
+///
+/// N is the number of characters held without allocating, rounded up to
+/// fill the representation; the default keeps the object at three words,
+/// which on 64-bit holds 22 char or 10 two-byte wchar_t inline. Hot string
+/// types can pick a larger N to avoid the pool entirely.
+///
+template <typename T, class Alloc = allocator<T>, size_t N = __sso_capacity<T>(3 * sizeof(size_t))>
+class basic_string : private __alloc_holder<Alloc> {
    public:
     using pointer = T*;
     using const_pointer = const T*;
     using iterator = pointer;
     using const_iterator = const_pointer;
+    using allocator_type = Alloc;
+
+    static constexpr size_t npos = kStrNotFound;
 
-    basic_string() : size_(0), capacity_(kLocalSize - 1) { ; }
+    basic_string() {
+        reset();
+    }
+
+    explicit basic_string(const Alloc& al) : __alloc_holder<Alloc>(al) {
+        reset();
+    }
 
     basic_string(const_pointer ptr) : basic_string(ptr, length(ptr)) { ; }
 
-    basic_string(const_pointer ptr, size_t size) : size_(size), capacity_(capacity(size)) {
-        if (capacity_ > kLocalSize - 1) {
-            data_ = Alloc().allocate(capacity_ + 1);
-            assert(data_);
-            new (data_) T[capacity_ + 1]();
-            memcpy(data_, ptr, size_ * sizeof(T));
-        } else {
-            memcpy(local_, ptr, size_ * sizeof(T));
+    basic_string(const_pointer ptr, const Alloc& al) : basic_string(ptr, length(ptr), al) { ; }
+
+    basic_string(const_pointer ptr, size_t size) {
+        init(ptr, size);
+    }
+
+    basic_string(const_pointer ptr, size_t size, const Alloc& al) : __alloc_holder<Alloc>(al) {
+        init(ptr, size);
+    }
+
+    basic_string(const basic_string& other)
+        : basic_string(other.data(), other.size(), other.get_al()) { ; }
+
+    template <class OtherAlloc, size_t OtherN>
+    basic_string(const basic_string<T, OtherAlloc, OtherN>& other)
+        : basic_string(other.data(), other.size()) { ; }
+
+    /// @brief take the buffer of other, which is left empty
+    basic_string(basic_string&& other) noexcept : __alloc_holder<Alloc>(other.get_al()) {
+        take(other);
+    }
+
+    basic_string& operator=(const basic_string& other) {
+        if (this != &other) {
+            basic_string tmp(other.data(), other.size(), this->get_al());
+            swap(tmp);
         }
+        return *this;
     }
 
-    template <class OtherAlloc = allocator<T, Tag>>
-    basic_string(const basic_string<T, OtherAlloc>& other) {
-        basic_string tmp(other.data(), other.size());
+    template <class OtherAlloc, size_t OtherN>
+    basic_string& operator=(const basic_string<T, OtherAlloc, OtherN>& other) {
+        basic_string tmp(other.data(), other.size(), this->get_al());
         swap(tmp);
+        return *this;
     }
 
-    template <class OtherAlloc = allocator<T, Tag>>
-    basic_string& operator=(const basic_string<T, OtherAlloc>& other) {
-        basic_string tmp(other.data(), other.size());
-        swap(tmp);
+    basic_string& operator=(basic_string&& other) noexcept {
+        if (this != &other) {
+            tidy();
+            this->get_al() = other.get_al();
+            take(other);
+        }
         return *this;
     }
 
     ~basic_string() {
-        if (capacity_ > kLocalSize - 1) {
-            if (data_) {
-                Alloc().deallocate(data_, capacity_ + 1);
-                data_ = nullptr;
-            }
-        }
+        tidy();
+    }
+
+    allocator_type get_allocator() const {
+        return this->get_al();
     }
 
     T& operator[](size_t pos) {
@@ -64,74 +220,177 @@ class basic_string {
     }
 
     bool operator==(const basic_string& str) const {
-        if (str.size_ != size_ || capacity_ != str.capacity_) {
-            return false;
-        }
-
-        return memcmp(data(), str.data(), size_ * sizeof(T)) == 0;
+        return basic_string_view<T>(*this) == basic_string_view<T>(str);
     }
 
     bool operator!=(const basic_string& str) const {
         return !(*this == str);
     }
 
+    operator basic_string_view<T>() const {
+        return basic_string_view<T>(data(), size());
+    }
+
+    bool operator==(basic_string_view<T> str) const {
+        return basic_string_view<T>(*this) == str;
+    }
+
+    bool operator!=(basic_string_view<T> str) const {
+        return !(*this == str);
+    }
+
+    bool operator==(const_pointer str) const {
+        return basic_string_view<T>(*this) == basic_string_view<T>(str);
+    }
+
+    bool operator!=(const_pointer str) const {
+        return !(*this == str);
+    }
+
+    bool operator<(basic_string_view<T> str) const {
+        return basic_string_view<T>(*this) < str;
+    }
+
+    int compare(basic_string_view<T> str) const {
+        return basic_string_view<T>(*this).compare(str);
+    }
+
+    int compare_icase(basic_string_view<T> str) const {
+        return basic_string_view<T>(*this).compare_icase(str);
+    }
+
+    bool equal_icase(basic_string_view<T> str) const {
+        return basic_string_view<T>(*this).equal_icase(str);
+    }
+
+    size_t find(T c, size_t pos = 0) const {
+        return basic_string_view<T>(*this).find(c, pos);
+    }
+
+    size_t find(basic_string_view<T> str, size_t pos = 0) const {
+        return basic_string_view<T>(*this).find(str, pos);
+    }
+
     basic_string& append(const T* ptr) {
         return append(ptr, length(ptr));
     }
 
     basic_string& append(const T* ptr, size_t n) {
-        if (n + size_ > capacity_) {
-            reserve(n + size_);
+        size_t size = this->size();
+        if (n + size > capacity()) {
+            // ptr may point into this string, whose buffer is about to move
+            const_pointer old = data();
+            bool inside = ptr >= old && ptr < old + size;
+            size_t offset = inside ? ptr - old : 0;
+            reserve(grow_capacity(n + size));
+            if (inside) {
+                ptr = data() + offset;
+            }
         }
 
-        if (capacity_ > kLocalSize - 1) {
-            memcpy(data_ + size_, ptr, n * sizeof(T));
-            data_[size_ + n] = {};
-        } else {
-            memcpy(local_ + size_, ptr, n * sizeof(T));
-            local_[size_ + n] = {};
+        pointer p = data();
+        memcpy(p + size, ptr, n * sizeof(T));
+        size += n;
+        set_size(size);
+        p[size] = T();
+        return *this;
+    }
+
+    basic_string& append(basic_string_view<T> str) {
+        return append(str.data(), str.size());
+    }
+
+    void push_back(T c) {
+        size_t size = this->size();
+        if (size == capacity()) {
+            reserve(grow_capacity(size + 1));
         }
-        size_ += n;
+
+        pointer p = data();
+        p[size++] = c;
+        set_size(size);
+        p[size] = T();
+    }
+
+    basic_string& operator+=(basic_string_view<T> str) {
+        return append(str.data(), str.size());
+    }
+
+    basic_string& operator+=(T c) {
+        push_back(c);
         return *this;
     }
 
     void clear() {
-        size_ = 0;
+        set_size(0);
+        data()[0] = T();
+    }
+
+    /// @brief make room for n characters, so appends up to n do not reallocate
+    void reserve(size_t n) {
+        n = capacity(n);
+        if (n > capacity()) {
+            size_t size = this->size();
+            T* tmp = allocate(n);
+            memcpy(tmp, data(), (size + 1) * sizeof(T));
+            tidy_buffer();
+            set_long(tmp, n, size);
+        }
     }
 
-    void swap(basic_string& right) {
-        size_t size = 0;
-        size_t capacity = 0;
-        T local[kLocalSize] = {0};
-        size = right.size_;
-        capacity = right.capacity_;
-        memmove(local, right.local_, sizeof(local));
+    /// @brief drop unused capacity (moves back inline when the characters fit)
+    void shrink_to_fit() {
+        size_t size = this->size();
+        size_t n = capacity(size);
+        if (n < capacity()) {
+            // the buffer is long, and the short form overlays its fields
+            T* buffer = rep_.l.data_;
+            size_t buffer_capacity = capacity();
+            if (n > kShortCapacity) {
+                set_long(allocate(n), n, size);
+            } else {
+                set_short(size);
+            }
+            memcpy(data(), buffer, (size + 1) * sizeof(T));
+            deallocate(buffer, buffer_capacity);
+        }
+    }
 
-        right.size_ = size_;
-        right.capacity_ = capacity_;
-        memmove(right.local_, local_, sizeof(right.local_));
+    ///
+    /// Resize to at most n characters written in place: op(p, n) gets the
+    /// buffer p, holding the current characters and room for n, fills it and
+    /// returns the new size (<= n). Nothing is initialized for op:
+    ///
+    ///   path.resize_and_overwrite(MAX_PATH, [](wchar_t* p, size_t n) {
+    ///       return static_cast<size_t>(GetModuleFileNameW(nullptr, p, static_cast<DWORD>(n)));
+    ///   });
+    ///
+    template <class Operation>
+    void resize_and_overwrite(size_t n, Operation op) {
+        reserve(n);
+        pointer p = data();
+        size_t size = static_cast<size_t>(op(p, n));
+        set_size(size);
+        p[size] = T();
+    }
+
+    void swap(basic_string& right) noexcept {
+        // either form moves bitwise, the short characters live in the object
+        __rep rep = rep_;
+        rep_ = right.rep_;
+        right.rep_ = rep;
 
-        size_ = size;
-        capacity_ = capacity;
-        memmove(local_, local, sizeof(local_));
+        Alloc al = this->get_al();
+        this->get_al() = right.get_al();
+        right.get_al() = al;
     }
 
     void upper() {
-        for (auto i = 0; i < size_; i++) {
-            pointer p = data();
-            if (p[i] >= T('a') && p[i] <= T('z')) {
-                p[i] = p[i] - T('a') + T('A');
-            }
-        }
+        str_upper(data(), size());
     }
 
     void lower() {
-        for (auto i = 0; i < size_; i++) {
-            pointer p = data();
-            if (p[i] >= T('A') && p[i] <= T('Z')) {
-                p[i] = p[i] - T('A') + T('a');
-            }
-        }
+        str_lower(data(), size());
     }
 
     const_pointer c_str() const {
@@ -139,79 +398,180 @@ class basic_string {
     }
 
     pointer data() {
-        if (capacity_ > kLocalSize - 1) {
-            return data_;
-        }
-        return local_;
+        return is_long() ? rep_.l.data_ : rep_.s.data_;
     }
 
     const_pointer data() const {
-        if (capacity_ > kLocalSize - 1) {
-            return data_;
-        }
-        return local_;
+        return is_long() ? rep_.l.data_ : rep_.s.data_;
     }
 
     size_t size() const {
-        return size_;
+        return is_long() ? rep_.l.size_ : rep_.s.size_ >> 1;
     }
 
     size_t capacity() const {
-        return capacity_;
+        return is_long() ? rep_.l.cap_ >> 1 : kShortCapacity;
     }
 
    private:
-    void reserve(size_t n) {
-        n = capacity(n);
-        if (n > capacity_) {
-            Alloc al;
-            T* tmp = al.allocate(n + 1);
-            assert(tmp);
-            for (auto i = 0; i < size_; i++) {
-                new (tmp + i) T(data()[i]);
-            }
+    void init(const_pointer ptr, size_t size) {
+        if (size > kShortCapacity) {
+            size_t n = capacity(size);
+            set_long(allocate(n), n, size);
+        } else {
+            set_short(size);
+        }
+        pointer p = data();
+        memcpy(p, ptr, size * sizeof(T));
+        p[size] = T();
+    }
 
-            if (capacity_ > kLocalSize - 1) {
-                al.deallocate(data_, size_);
-            }
-            data_ = tmp;
-            capacity_ = n;
+    bool is_long() const {
+        // the first byte is the short size or the low byte of the long capacity
+        return rep_.s.size_ & 1;
+    }
+
+    void set_short(size_t size) {
+        rep_.s.size_ = static_cast<unsigned char>(size << 1);
+    }
+
+    void set_long(pointer p, size_t capacity, size_t size) {
+        rep_.l.cap_ = capacity << 1 | 1;
+        rep_.l.size_ = size;
+        rep_.l.data_ = p;
+    }
+
+    void set_size(size_t size) {
+        if (is_long()) {
+            rep_.l.size_ = size;
+        } else {
+            set_short(size);
+        }
+    }
+
+    /// @brief buffer for capacity characters and the terminator
+    T* allocate(size_t capacity) {
+        T* p = this->get_al().allocate(capacity + 1);
+        assert(p);
+        _RTL_TRACK_CONTAINER(string, 1, (capacity + 1) * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t capacity) {
+        _RTL_TRACK_CONTAINER(string, -1, (capacity + 1) * sizeof(T));
+        this->get_al().deallocate(p, capacity + 1);
+    }
+
+    /// @brief free the heap buffer, if any; the representation is left for the caller
+    void tidy_buffer() {
+        if (is_long()) {
+            deallocate(rep_.l.data_, capacity());
         }
     }
 
+    /// @brief empty short string
+    void reset() {
+        set_short(0);
+        rep_.s.data_[0] = T();
+    }
+
+    /// @brief free the heap buffer and become empty
+    void tidy() {
+        tidy_buffer();
+        reset();
+    }
+
+    /// @brief move the characters of other here (this is empty), leaving other empty
+    void take(basic_string& other) {
+        rep_ = other.rep_;
+        other.reset();
+    }
+
     size_t capacity(size_t n) const {
-        if (n > kLocalSize - 1) {
-            return (n * sizeof(T) / kAllocSize + 1) * kLocalSize - 1;
+        if (n > kShortCapacity) {
+            return (n * sizeof(T) / kAllocSize + 1) * (kAllocSize / sizeof(T)) - 1;
         }
-        return kLocalSize - 1;
+        return kShortCapacity;
+    }
+
+    /// @brief capacity for n characters, at least doubling the current one
+    /// so that repeated appends copy each character O(1) times
+    size_t grow_capacity(size_t n) const {
+        size_t grow = capacity() * 2 + 1;
+        return capacity(grow > n ? grow : n);
     }
 
     size_t length(const T* ptr) const {
-        size_t count = 0;
-        while (*ptr != T()) {
-            ptr++;
-            count++;
-        }
-        return count;
+        return str_length(ptr);
     }
 
    private:
     static const size_t kAllocSize = 16;
-    static const size_t kLocalSize = kAllocSize / sizeof(T);
+    static const size_t kRepSize = __sso_bytes<T>(N);
+    static const size_t kShortCapacity = __sso_capacity<T>(kRepSize);
 
-    size_t size_ = 0;
-    size_t capacity_ = 0;
-    union {
+    static_assert(kShortCapacity <= 127, "the short size must fit the size byte next to its flag");
+
+    struct __long {
+        size_t cap_;  // capacity << 1 | 1
+        size_t size_;
         pointer data_;
-        T local_[kLocalSize] = {};
     };
+
+    struct __short {
+        unsigned char size_;  // size << 1
+        T data_[kShortCapacity + 1];
+    };
+
+    union __rep {
+        __long l;
+        __short s;
+    };
+
+    static_assert(sizeof(__rep) == kRepSize, "unexpected basic_string layout");
+
+    __rep rep_;
 };
 
-template <class _Kty>
-struct hash<rtl::basic_string<_Kty>> : _Conditionally_enabled_hash<rtl::basic_string<_Kty>, true> {
-    static size_t _Do_hash(const rtl::basic_string<_Kty>& _Keyval) noexcept {
+// no pointer into the object itself (data() is recomputed), moves bitwise
+template <typename T, class Alloc, size_t N>
+struct is_trivially_relocatable<basic_string<T, Alloc, N>> : is_trivially_relocatable<Alloc> {};
+
+//
+// transparent: views and C strings hash like the basic_string with the
+// same characters, so maps keyed by basic_string can be searched with them
+// (together with equal_to<>)
+//
+template <class _Kty, class _Alloc, size_t _Nx>
+struct hash<rtl::basic_string<_Kty, _Alloc, _Nx>>
+    : _Conditionally_enabled_hash<rtl::basic_string<_Kty, _Alloc, _Nx>, true> {
+    using is_transparent = int;
+    using _Conditionally_enabled_hash<rtl::basic_string<_Kty, _Alloc, _Nx>, true>::operator();
+
+    _NODISCARD size_t operator()(basic_string_view<_Kty> _Keyval) const noexcept {
+        return _Do_hash(_Keyval);
+    }
+
+    _NODISCARD size_t operator()(const _Kty* _Keyval) const noexcept {
+        return _Do_hash(basic_string_view<_Kty>(_Keyval));
+    }
+
+    static size_t _Do_hash(basic_string_view<_Kty> _Keyval) noexcept {
         // hash _Keyval to size_t value by pseudorandomizing transform
-        return _Fnv1a_append_bytes(_FNV_offset_basis, reinterpret_cast<const unsigned char*>(_Keyval.c_str()), _Keyval.size() * sizeof(_Kty));
+        return _Hash_result(_Hash_bytes(_Keyval.data(), _Keyval.size() * sizeof(_Kty)));
+    }
+};
+
+template <class _Kty, class _Alloc, size_t _Nx>
+struct crc32c_hash<rtl::basic_string<_Kty, _Alloc, _Nx>> {
+    using is_transparent = int;
+
+    _NODISCARD size_t operator()(basic_string_view<_Kty> _Keyval) const noexcept {
+        return _Hash_result(_Hash_integer(crc32c(_Keyval.data(), _Keyval.size() * sizeof(_Kty))));
+    }
+
+    _NODISCARD size_t operator()(const _Kty* _Keyval) const noexcept {
+        return (*this)(basic_string_view<_Kty>(_Keyval));
     }
 };
 
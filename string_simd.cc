@@ -0,0 +1,560 @@
+#include "string_simd.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "cpu.h"
+#include "simd.h"
+
+// AVX2 needs its register state saved around kernel use, so only user mode takes it
+// (and not with _RTL_NO_AVX2, which keeps user mode on the SSE2 kernels)
+#if defined(_RTL_SSE2) && !(defined(_WIN32) && defined(_KRTL)) && !defined(_RTL_NO_AVX2)
+#define STRING_AVX2 1
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// Kernels are force-inlined into their entry points, so the AVX2 ones only
+// ever run inside AVX2_TARGET functions and pass vectors the AVX2 way; the
+// out-of-line copies GCC warns about are never called.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL __forceinline
+#else
+#define KERNEL __attribute__((always_inline)) inline
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
+
+// Load serves Length, which reads whole aligned blocks: past the terminator
+// but never past its page
+#if defined(__SANITIZE_ADDRESS__)
+#define NO_ASAN __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#endif
+#if !defined(NO_ASAN)
+#define NO_ASAN
+#endif
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// scalar
+//
+template <class E>
+using Unsigned = rtl::conditional_t<sizeof(E) == 1, uint8_t, rtl::conditional_t<sizeof(E) == 2, uint16_t, uint32_t>>;
+
+/// @brief c with the ASCII letters from lo to lo + 25 flipped to the other case
+template <class E>
+E FoldChar(E c, uint32_t lo) {
+    return static_cast<uint32_t>(static_cast<Unsigned<E>>(c)) - lo < 26 ? static_cast<E>(c ^ 0x20) : c;
+}
+
+/// @brief value characters are ordered by: unsigned for char, as is for wchar_t
+template <class E>
+long long OrderOf(E c) {
+    if constexpr (sizeof(E) == 1) {
+        return static_cast<unsigned char>(c);
+    } else {
+        return static_cast<long long>(c);
+    }
+}
+
+template <class E>
+size_t LengthScalar(const E* s) {
+    const E* p = s;
+    while (*p != E()) {
+        p++;
+    }
+    return p - s;
+}
+
+template <class E>
+void FoldScalar(E* s, size_t n, uint32_t lo) {
+    for (size_t i = 0; i < n; i++) {
+        s[i] = FoldChar(s[i], lo);
+    }
+}
+
+template <bool Icase, class E>
+size_t MismatchScalar(const E* x, const E* y, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        E a = Icase ? FoldChar(x[i], 'A') : x[i];
+        E b = Icase ? FoldChar(y[i], 'A') : y[i];
+        if (a != b) {
+            return i;
+        }
+    }
+    return n;
+}
+
+template <class E>
+size_t FindScalar(const E* s, size_t n, E c) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == c) {
+            return i;
+        }
+    }
+    return rtl::kStrNotFound;
+}
+
+template <class E>
+size_t FindScalar(const E* s, size_t n, const E* sub, size_t m) {
+    for (size_t i = 0; i + m <= n; i++) {
+        if (s[i] == sub[0] && memcmp(s + i, sub, m * sizeof(E)) == 0) {
+            return i;
+        }
+    }
+    return rtl::kStrNotFound;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// instruction sets
+//
+// The kernels below are written once against these wrappers; B is the
+// width of a lane in bytes (the character size).
+//
+#if defined(_RTL_SSE2)
+struct Sse2 {
+    using Vec = __m128i;
+    static constexpr size_t kWidth = 16;
+    static constexpr unsigned kAllBits = 0xffff;
+
+    NO_ASAN static Vec Load(const void* p) { return _mm_load_si128(static_cast<const __m128i*>(p)); }
+
+    static Vec LoadU(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+
+    static void StoreU(void* p, Vec v) { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+
+    static Vec And(Vec x, Vec y) { return _mm_and_si128(x, y); }
+
+    static Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+
+    static unsigned MoveMask(Vec v) { return static_cast<unsigned>(_mm_movemask_epi8(v)); }
+
+    template <size_t B>
+    static Vec Set1(uint32_t c) {
+        if constexpr (B == 1) {
+            return _mm_set1_epi8(static_cast<char>(c));
+        } else if constexpr (B == 2) {
+            return _mm_set1_epi16(static_cast<short>(c));
+        } else {
+            return _mm_set1_epi32(static_cast<int>(c));
+        }
+    }
+
+    template <size_t B>
+    static Vec Add(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm_add_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm_add_epi16(x, y);
+        } else {
+            return _mm_add_epi32(x, y);
+        }
+    }
+
+    template <size_t B>
+    static Vec CmpEq(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm_cmpeq_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm_cmpeq_epi16(x, y);
+        } else {
+            return _mm_cmpeq_epi32(x, y);
+        }
+    }
+
+    /// @brief signed x > y
+    template <size_t B>
+    static Vec CmpGt(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm_cmpgt_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm_cmpgt_epi16(x, y);
+        } else {
+            return _mm_cmpgt_epi32(x, y);
+        }
+    }
+};
+#endif
+
+#if defined(STRING_AVX2)
+struct Avx2 {
+    using Vec = __m256i;
+    static constexpr size_t kWidth = 32;
+    static constexpr unsigned kAllBits = 0xffffffff;
+
+    AVX2_TARGET NO_ASAN static Vec Load(const void* p) { return _mm256_load_si256(static_cast<const __m256i*>(p)); }
+
+    AVX2_TARGET static Vec LoadU(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+
+    AVX2_TARGET static void StoreU(void* p, Vec v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+
+    AVX2_TARGET static Vec And(Vec x, Vec y) { return _mm256_and_si256(x, y); }
+
+    AVX2_TARGET static Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+
+    AVX2_TARGET static unsigned MoveMask(Vec v) { return static_cast<unsigned>(_mm256_movemask_epi8(v)); }
+
+    template <size_t B>
+    AVX2_TARGET static Vec Set1(uint32_t c) {
+        if constexpr (B == 1) {
+            return _mm256_set1_epi8(static_cast<char>(c));
+        } else if constexpr (B == 2) {
+            return _mm256_set1_epi16(static_cast<short>(c));
+        } else {
+            return _mm256_set1_epi32(static_cast<int>(c));
+        }
+    }
+
+    template <size_t B>
+    AVX2_TARGET static Vec Add(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm256_add_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm256_add_epi16(x, y);
+        } else {
+            return _mm256_add_epi32(x, y);
+        }
+    }
+
+    template <size_t B>
+    AVX2_TARGET static Vec CmpEq(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm256_cmpeq_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm256_cmpeq_epi16(x, y);
+        } else {
+            return _mm256_cmpeq_epi32(x, y);
+        }
+    }
+
+    template <size_t B>
+    AVX2_TARGET static Vec CmpGt(Vec x, Vec y) {
+        if constexpr (B == 1) {
+            return _mm256_cmpgt_epi8(x, y);
+        } else if constexpr (B == 2) {
+            return _mm256_cmpgt_epi16(x, y);
+        } else {
+            return _mm256_cmpgt_epi32(x, y);
+        }
+    }
+};
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// kernels
+//
+template <class Isa, class E>
+struct Kernels {
+    using Vec = typename Isa::Vec;
+    static constexpr size_t B = sizeof(E);
+    static constexpr size_t kLanes = Isa::kWidth / B;
+    static constexpr uint32_t kSignBit = 1u << (8 * B - 1);
+
+    KERNEL static Vec Splat(E c) { return Isa::template Set1<B>(static_cast<Unsigned<E>>(c)); }
+
+    /// @brief lanes holding lo .. lo + 25: moved to the bottom of the signed
+    /// range, that is one signed compare
+    KERNEL static Vec InRange(const Vec& v, uint32_t lo) {
+        Vec t = Isa::template Add<B>(v, Isa::template Set1<B>(kSignBit - lo));
+        return Isa::template CmpGt<B>(Isa::template Set1<B>(kSignBit + 26), t);
+    }
+
+    KERNEL static Vec Fold(const Vec& v, uint32_t lo) {
+        return Isa::Xor(v, Isa::And(InRange(v, lo), Isa::template Set1<B>(0x20)));
+    }
+
+    KERNEL static size_t Length(const E* s) {
+        // the aligned block holding s lies within one page, bytes before s are shifted out
+        size_t skip = reinterpret_cast<uintptr_t>(s) & (Isa::kWidth - 1);
+        const char* p = reinterpret_cast<const char*>(s) - skip;
+        const Vec zero = Isa::template Set1<B>(0);
+        unsigned mask = Isa::MoveMask(Isa::template CmpEq<B>(Isa::Load(p), zero)) >> skip;
+        if (mask) {
+            return rtl::countr_zero(mask) / B;
+        }
+
+        for (;;) {
+            p += Isa::kWidth;
+            mask = Isa::MoveMask(Isa::template CmpEq<B>(Isa::Load(p), zero));
+            if (mask) {
+                return (p - reinterpret_cast<const char*>(s) + rtl::countr_zero(mask)) / B;
+            }
+        }
+    }
+
+    KERNEL static void FoldInPlace(E* s, size_t n, uint32_t lo) {
+        size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            Isa::StoreU(s + i, Fold(Isa::LoadU(s + i), lo));
+        }
+        FoldScalar(s + i, n - i, lo);
+    }
+
+    template <bool Icase>
+    KERNEL static size_t Mismatch(const E* x, const E* y, size_t n) {
+        size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            Vec a = Isa::LoadU(x + i);
+            Vec b = Isa::LoadU(y + i);
+            if (Icase) {
+                a = Fold(a, 'A');
+                b = Fold(b, 'A');
+            }
+            unsigned mask = ~Isa::MoveMask(Isa::template CmpEq<B>(a, b)) & Isa::kAllBits;
+            if (mask) {
+                return i + rtl::countr_zero(mask) / B;
+            }
+        }
+        return i + MismatchScalar<Icase>(x + i, y + i, n - i);
+    }
+
+    KERNEL static size_t Find(const E* s, size_t n, E c) {
+        const Vec needle = Splat(c);
+        size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            unsigned mask = Isa::MoveMask(Isa::template CmpEq<B>(Isa::LoadU(s + i), needle));
+            if (mask) {
+                return i + rtl::countr_zero(mask) / B;
+            }
+        }
+        size_t pos = FindScalar(s + i, n - i, c);
+        return pos == rtl::kStrNotFound ? pos : i + pos;
+    }
+
+    /// @brief candidates match the first and the last character of sub, only
+    /// those get compared in full; m >= 2
+    KERNEL static size_t Find(const E* s, size_t n, const E* sub, size_t m) {
+        const Vec first = Splat(sub[0]);
+        const Vec last = Splat(sub[m - 1]);
+        size_t i = 0;
+        for (; i + m - 1 + kLanes <= n; i += kLanes) {
+            unsigned mask = Isa::MoveMask(Isa::And(Isa::template CmpEq<B>(Isa::LoadU(s + i), first),
+                                                   Isa::template CmpEq<B>(Isa::LoadU(s + i + m - 1), last)));
+            while (mask) {
+                unsigned bit = rtl::countr_zero(mask);
+                size_t pos = i + bit / B;
+                if (memcmp(s + pos + 1, sub + 1, (m - 2) * B) == 0) {
+                    return pos;
+                }
+                mask &= ~(((1u << B) - 1) << bit);  // all bytes of the lane
+            }
+        }
+        size_t pos = FindScalar(s + i, n - i, sub, m);
+        return pos == rtl::kStrNotFound ? pos : i + pos;
+    }
+};
+
+#if defined(STRING_AVX2)
+template <class E>
+AVX2_TARGET size_t LengthAvx2(const E* s) {
+    return Kernels<Avx2, E>::Length(s);
+}
+
+template <class E>
+AVX2_TARGET void FoldAvx2(E* s, size_t n, uint32_t lo) {
+    Kernels<Avx2, E>::FoldInPlace(s, n, lo);
+}
+
+template <bool Icase, class E>
+AVX2_TARGET size_t MismatchAvx2(const E* x, const E* y, size_t n) {
+    return Kernels<Avx2, E>::template Mismatch<Icase>(x, y, n);
+}
+
+template <class E>
+AVX2_TARGET size_t FindAvx2(const E* s, size_t n, E c) {
+    return Kernels<Avx2, E>::Find(s, n, c);
+}
+
+template <class E>
+AVX2_TARGET size_t FindAvx2(const E* s, size_t n, const E* sub, size_t m) {
+    return Kernels<Avx2, E>::Find(s, n, sub, m);
+}
+
+bool UseAvx2() {
+    return rtl::cpu_has(rtl::cpu_feature::avx2);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// dispatch
+//
+template <class E>
+size_t Length(const E* s) {
+#if defined(STRING_AVX2)
+    if (UseAvx2()) {
+        return LengthAvx2(s);
+    }
+#endif
+#if defined(_RTL_SSE2)
+    return Kernels<Sse2, E>::Length(s);
+#else
+    return LengthScalar(s);
+#endif
+}
+
+template <class E>
+void Fold(E* s, size_t n, uint32_t lo) {
+#if defined(STRING_AVX2)
+    if (UseAvx2()) {
+        return FoldAvx2(s, n, lo);
+    }
+#endif
+#if defined(_RTL_SSE2)
+    Kernels<Sse2, E>::FoldInPlace(s, n, lo);
+#else
+    FoldScalar(s, n, lo);
+#endif
+}
+
+template <bool Icase, class E>
+size_t Mismatch(const E* x, const E* y, size_t n) {
+#if defined(STRING_AVX2)
+    if (UseAvx2()) {
+        return MismatchAvx2<Icase>(x, y, n);
+    }
+#endif
+#if defined(_RTL_SSE2)
+    return Kernels<Sse2, E>::template Mismatch<Icase>(x, y, n);
+#else
+    return MismatchScalar<Icase>(x, y, n);
+#endif
+}
+
+template <bool Icase, class E>
+int Compare(const E* x, size_t nx, const E* y, size_t ny) {
+    size_t n = nx < ny ? nx : ny;
+    size_t i = Mismatch<Icase>(x, y, n);
+    if (i < n) {
+        long long a = OrderOf(Icase ? FoldChar(x[i], 'A') : x[i]);
+        long long b = OrderOf(Icase ? FoldChar(y[i], 'A') : y[i]);
+        return a < b ? -1 : 1;
+    }
+    return nx < ny ? -1 : nx > ny ? 1 : 0;
+}
+
+template <class E>
+size_t Find(const E* s, size_t n, E c) {
+#if defined(STRING_AVX2)
+    if (UseAvx2()) {
+        return FindAvx2(s, n, c);
+    }
+#endif
+#if defined(_RTL_SSE2)
+    return Kernels<Sse2, E>::Find(s, n, c);
+#else
+    return FindScalar(s, n, c);
+#endif
+}
+
+template <class E>
+size_t Find(const E* s, size_t n, const E* sub, size_t m) {
+    if (m == 0) {
+        return 0;
+    }
+    if (m > n) {
+        return rtl::kStrNotFound;
+    }
+    if (m == 1) {
+        return Find(s, n, sub[0]);
+    }
+#if defined(STRING_AVX2)
+    if (UseAvx2()) {
+        return FindAvx2(s, n, sub, m);
+    }
+#endif
+#if defined(_RTL_SSE2)
+    return Kernels<Sse2, E>::Find(s, n, sub, m);
+#else
+    return FindScalar(s, n, sub, m);
+#endif
+}
+
+}  // namespace
+
+size_t rtl::str_length(const char* s) noexcept {
+    return Length(s);
+}
+
+size_t rtl::str_length(const wchar_t* s) noexcept {
+    return Length(s);
+}
+
+void rtl::str_upper(char* s, size_t n) noexcept {
+    Fold(s, n, 'a');
+}
+
+void rtl::str_upper(wchar_t* s, size_t n) noexcept {
+    Fold(s, n, 'a');
+}
+
+void rtl::str_lower(char* s, size_t n) noexcept {
+    Fold(s, n, 'A');
+}
+
+void rtl::str_lower(wchar_t* s, size_t n) noexcept {
+    Fold(s, n, 'A');
+}
+
+size_t rtl::str_mismatch(const char* x, const char* y, size_t n) noexcept {
+    return Mismatch<false>(x, y, n);
+}
+
+size_t rtl::str_mismatch(const wchar_t* x, const wchar_t* y, size_t n) noexcept {
+    return Mismatch<false>(x, y, n);
+}
+
+size_t rtl::str_mismatch_icase(const char* x, const char* y, size_t n) noexcept {
+    return Mismatch<true>(x, y, n);
+}
+
+size_t rtl::str_mismatch_icase(const wchar_t* x, const wchar_t* y, size_t n) noexcept {
+    return Mismatch<true>(x, y, n);
+}
+
+int rtl::str_compare(const char* x, size_t nx, const char* y, size_t ny) noexcept {
+    return Compare<false>(x, nx, y, ny);
+}
+
+int rtl::str_compare(const wchar_t* x, size_t nx, const wchar_t* y, size_t ny) noexcept {
+    return Compare<false>(x, nx, y, ny);
+}
+
+int rtl::str_compare_icase(const char* x, size_t nx, const char* y, size_t ny) noexcept {
+    return Compare<true>(x, nx, y, ny);
+}
+
+int rtl::str_compare_icase(const wchar_t* x, size_t nx, const wchar_t* y, size_t ny) noexcept {
+    return Compare<true>(x, nx, y, ny);
+}
+
+size_t rtl::str_find(const char* s, size_t n, char c) noexcept {
+    return Find(s, n, c);
+}
+
+size_t rtl::str_find(const wchar_t* s, size_t n, wchar_t c) noexcept {
+    return Find(s, n, c);
+}
+
+size_t rtl::str_find(const char* s, size_t n, const char* sub, size_t m) noexcept {
+    return Find(s, n, sub, m);
+}
+
+size_t rtl::str_find(const wchar_t* s, size_t n, const wchar_t* sub, size_t m) noexcept {
+    return Find(s, n, sub, m);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+/// @file Vectorized string kernels
+#ifndef _STRING_SIMD_H
+#define _STRING_SIMD_H
+
+#include <cstddef>
+
+namespace rtl {
+
+//
+// Scanning, comparison and ASCII case folding for char and wchar_t strings.
+// Kernels use AVX2 when the CPU has it (user mode only, unless built with
+// _RTL_NO_AVX2), SSE2 otherwise and plain loops where neither exists. Case folding and the case-insensitive
+// kernels only map ASCII letters. Characters compare by their unsigned value
+// for char and by their value for wchar_t, as memcmp and wmemcmp do.
+//
+constexpr size_t kStrNotFound = static_cast<size_t>(-1);
+
+/// @return number of characters before the terminating 0
+size_t str_length(const char* s) noexcept;
+size_t str_length(const wchar_t* s) noexcept;
+
+/// @brief ASCII letters of s[0, n) to upper / lower case, in place
+void str_upper(char* s, size_t n) noexcept;
+void str_upper(wchar_t* s, size_t n) noexcept;
+void str_lower(char* s, size_t n) noexcept;
+void str_lower(wchar_t* s, size_t n) noexcept;
+
+/// @return index of the first position where x[0, n) and y[0, n) differ, or n
+size_t str_mismatch(const char* x, const char* y, size_t n) noexcept;
+size_t str_mismatch(const wchar_t* x, const wchar_t* y, size_t n) noexcept;
+
+/// @brief str_mismatch ignoring ASCII case
+size_t str_mismatch_icase(const char* x, const char* y, size_t n) noexcept;
+size_t str_mismatch_icase(const wchar_t* x, const wchar_t* y, size_t n) noexcept;
+
+/// @return <0, 0 or >0 as x[0, nx) sorts before, equal to or after y[0, ny)
+int str_compare(const char* x, size_t nx, const char* y, size_t ny) noexcept;
+int str_compare(const wchar_t* x, size_t nx, const wchar_t* y, size_t ny) noexcept;
+
+/// @brief str_compare ignoring ASCII case, both strings are left untouched
+int str_compare_icase(const char* x, size_t nx, const char* y, size_t ny) noexcept;
+int str_compare_icase(const wchar_t* x, size_t nx, const wchar_t* y, size_t ny) noexcept;
+
+/// @return index of the first c in s[0, n), or kStrNotFound
+size_t str_find(const char* s, size_t n, char c) noexcept;
+size_t str_find(const wchar_t* s, size_t n, wchar_t c) noexcept;
+
+/// @return index of the first occurrence of sub[0, m) in s[0, n), or kStrNotFound
+size_t str_find(const char* s, size_t n, const char* sub, size_t m) noexcept;
+size_t str_find(const wchar_t* s, size_t n, const wchar_t* sub, size_t m) noexcept;
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "sync.h"
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+
+static_assert(rtl::kApcLevel == APC_LEVEL && rtl::kDispatchLevel == DISPATCH_LEVEL, "IRQL values");
+
+unsigned char rtl::raise_irql(unsigned char level) noexcept {
+    KIRQL irql = KeGetCurrentIrql();
+    if (irql < level) {
+        KeRaiseIrql(level, &irql);
+    }
+    return irql;
+}
+
+void rtl::lower_irql(unsigned char irql) noexcept {
+    if (irql < KeGetCurrentIrql()) {
+        KeLowerIrql(irql);
+    }
+}
+
+#endif
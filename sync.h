@@ -0,0 +1,232 @@
+/// @file Minimal synchronization primitives (kernel and user mode)
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "common.h"
+
+namespace rtl {
+
+//////////////////////////////////////////////////////////////////////////
+//
+// cpu_relax
+//
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// atomics (relaxed, for statistics)
+//
+inline long long atomic_add(volatile long long* p, long long v) noexcept {  // returns the new value
+#if defined(_MSC_VER)
+    return _InterlockedExchangeAdd64(p, v) + v;
+#else
+    return __atomic_add_fetch(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+inline long long atomic_load(const volatile long long* p) noexcept {
+#if defined(_MSC_VER)
+    return *p;
+#else
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+/// @brief raise *p to at least v
+inline void atomic_max(volatile long long* p, long long v) noexcept {
+    long long cur = atomic_load(p);
+    while (cur < v) {
+#if defined(_MSC_VER)
+        long long prev = _InterlockedCompareExchange64(p, v, cur);
+        if (prev == cur) {
+            break;
+        }
+        cur = prev;
+#else
+        if (__atomic_compare_exchange_n(p, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+#endif
+    }
+}
+
+/// @brief full memory barrier
+inline void atomic_fence() noexcept {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+#elif defined(_MSC_VER)
+    _mm_mfence();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+//
+// pointer publication: a pointer stored with release is seen by an acquire
+// load together with everything written before the store
+//
+template <class T>
+inline T* atomic_load_acquire(T* const volatile* p) noexcept {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+    return reinterpret_cast<T*>(__ldar64(reinterpret_cast<const volatile unsigned __int64*>(p)));
+#elif defined(_MSC_VER)
+    T* v = *p;  // x86 and x64 loads are not reordered with later loads
+    _ReadWriteBarrier();
+    return v;
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+template <class T>
+inline void atomic_store_release(T* volatile* p, T* v) noexcept {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+    __stlr64(reinterpret_cast<volatile unsigned __int64*>(p), reinterpret_cast<unsigned __int64>(v));
+#elif defined(_MSC_VER)
+    _ReadWriteBarrier();  // nor stores with earlier stores
+    *p = v;
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// spin_lock
+//
+// Busy-wait lock that never changes IRQL, so the protected data may live
+// in paged pool. Keep the critical sections short.
+//
+class spin_lock {
+   public:
+    spin_lock() = default;
+    spin_lock(const spin_lock&) = delete;
+    spin_lock& operator=(const spin_lock&) = delete;
+
+    void lock() noexcept {
+        while (!try_lock()) {
+            while (locked_) {
+                cpu_relax();
+            }
+        }
+    }
+
+    _NODISCARD bool try_lock() noexcept {
+#if defined(_MSC_VER)
+        return _InterlockedExchange(&locked_, 1) == 0;
+#else
+        return __atomic_exchange_n(&locked_, 1, __ATOMIC_ACQUIRE) == 0;
+#endif
+    }
+
+    void unlock() noexcept {
+#if defined(_MSC_VER)
+        _InterlockedExchange(&locked_, 0);
+#else
+        __atomic_store_n(&locked_, 0, __ATOMIC_RELEASE);
+#endif
+    }
+
+   private:
+    volatile long locked_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// IRQL (kernel mode only, no-ops in user mode)
+//
+constexpr unsigned char kApcLevel = 1;       // APC_LEVEL
+constexpr unsigned char kDispatchLevel = 2;  // DISPATCH_LEVEL
+
+#if defined(_WIN32) && defined(_KRTL)
+/// @brief raise IRQL to at least level (never lowers it)
+/// @return the previous IRQL, to be passed to lower_irql (sync.cc)
+unsigned char raise_irql(unsigned char level) noexcept;
+void lower_irql(unsigned char irql) noexcept;
+#else
+inline unsigned char raise_irql(unsigned char) noexcept {
+    return 0;
+}
+
+inline void lower_irql(unsigned char) noexcept { ; }
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// irql_lock
+//
+// spin_lock held at IRQL Level or above, so nothing running at or below
+// Level on the holder's processor (a DPC for DISPATCH_LEVEL, an APC for
+// APC_LEVEL) can preempt the holder and spin on the lock forever. At
+// DISPATCH_LEVEL everything touched while it is held must be nonpaged.
+// Nested locks must be released in the reverse order of acquisition.
+//
+template <unsigned char Level>
+class irql_lock {
+   public:
+    irql_lock() = default;
+    irql_lock(const irql_lock&) = delete;
+    irql_lock& operator=(const irql_lock&) = delete;
+
+    void lock() noexcept {
+        unsigned char irql = raise_irql(Level);
+        lock_.lock();
+        irql_ = irql;
+    }
+
+    _NODISCARD bool try_lock() noexcept {
+        unsigned char irql = raise_irql(Level);
+        if (!lock_.try_lock()) {
+            lower_irql(irql);
+            return false;
+        }
+        irql_ = irql;
+        return true;
+    }
+
+    void unlock() noexcept {
+        unsigned char irql = irql_;
+        lock_.unlock();
+        lower_irql(irql);
+    }
+
+   private:
+    spin_lock lock_;
+    unsigned char irql_ = 0;
+};
+
+using dispatch_lock = irql_lock<kDispatchLevel>;
+using apc_lock = irql_lock<kApcLevel>;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// lock_guard
+//
+template <class Lock>
+class lock_guard {
+   public:
+    explicit lock_guard(Lock& lock) : lock_(lock) { lock_.lock(); }
+    ~lock_guard() { lock_.unlock(); }
+
+    lock_guard(const lock_guard&) = delete;
+    lock_guard& operator=(const lock_guard&) = delete;
+
+   private:
+    Lock& lock_;
+};
+
+}  // namespace rtl
+
+#endif
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+#include "slab.h"
+#include "struct.h"
+#include "sync.h"
+
+#if defined(_MSC_VER)
+#define TELEMETRY_NOINLINE __declspec(noinline)
+#else
+#define TELEMETRY_NOINLINE __attribute__((noinline))
+#endif
+
+#if defined(_WIN32) && defined(_KRTL)
+#include <ntifs.h>
+
+#define TELEMETRY_PRINT(...) DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, __VA_ARGS__)
+
+static size_t CurrentSlot() {
+    return KeGetCurrentProcessorNumberEx(nullptr);
+}
+
+#if _KRTL_TELEMETRY >= 2
+/// @brief n return addresses, skipping this function and skip more frames
+static TELEMETRY_NOINLINE size_t CaptureStack(size_t skip, const void** frames, size_t n) {
+    return RtlCaptureStackBackTrace(static_cast<ULONG>(skip + 1), static_cast<ULONG>(n), const_cast<PVOID*>(frames),
+                                    nullptr);
+}
+#endif
+#else
+#include <stdio.h>
+
+#define TELEMETRY_PRINT(...) printf(__VA_ARGS__)
+
+static volatile long long next_slot = 0;
+
+static size_t CurrentSlot() {
+    static thread_local size_t slot = static_cast<size_t>(rtl::atomic_add(&next_slot, 1));
+    return slot;
+}
+
+#if _KRTL_TELEMETRY >= 2
+#if defined(_WIN32)
+#include <windows.h>
+
+static TELEMETRY_NOINLINE size_t CaptureStack(size_t skip, const void** frames, size_t n) {
+    return RtlCaptureStackBackTrace(static_cast<DWORD>(skip + 1), static_cast<DWORD>(n), const_cast<PVOID*>(frames),
+                                    nullptr);
+}
+#else
+#include <execinfo.h>
+
+static TELEMETRY_NOINLINE size_t CaptureStack(size_t skip, const void** frames, size_t n) {
+    void* buffer[64];
+    skip += 1;
+    if (skip + n > 64) {
+        n = 64 - skip;
+    }
+    int count = backtrace(buffer, static_cast<int>(skip + n));
+    if (count <= static_cast<int>(skip)) {
+        return 0;
+    }
+    n = static_cast<size_t>(count) - skip;
+    memcpy(frames, buffer + skip, n * sizeof(void*));
+    return n;
+}
+#endif
+#endif
+#endif
+
+namespace {
+
+//
+// Counters are kept per slot (CPU, or thread in user mode) so the hot path
+// only does uncontended interlocked adds. Live bytes accumulate in the slot
+// and are folded into the global total once they exceed kBatchBytes, which
+// is also when the peak is updated.
+//
+constexpr size_t kSlots = 64;
+constexpr long long kBatchBytes = 16 * 1024;
+
+struct Counters {
+    volatile long long allocs;
+    volatile long long frees;
+    volatile long long pending;
+    volatile long long histogram[rtl::kTelemetryBuckets];
+};
+
+struct alignas(64) Slot {
+    Counters tag[kPoolTagCount];
+    Counters kind[rtl::kAllocKindCount];
+};
+
+struct Totals {
+    volatile long long live;
+    volatile long long peak;
+};
+
+Slot slots[kSlots];
+Totals tag_totals[kPoolTagCount];
+Totals kind_totals[rtl::kAllocKindCount];
+
+size_t HistogramBucket(size_t n) {
+    size_t bucket = 0;
+    for (size_t limit = 16; bucket < rtl::kTelemetryBuckets - 1 && n > limit; limit <<= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void Account(Counters& c, Totals& t, long long count, long long bytes) {
+    if (count > 0) {
+        rtl::atomic_add(&c.allocs, count);
+    } else {
+        rtl::atomic_add(&c.frees, -count);
+    }
+
+    long long pending = rtl::atomic_add(&c.pending, bytes);
+    if (pending >= kBatchBytes || pending <= -kBatchBytes) {
+        rtl::atomic_add(&c.pending, -pending);
+        rtl::atomic_max(&t.peak, rtl::atomic_add(&t.live, pending));
+    }
+}
+
+void Sum(rtl::telemetry_counters& out, const Counters* const* c, size_t n, const Totals& t) {
+    memset(&out, 0, sizeof(out));
+    out.live_bytes = rtl::atomic_load(&t.live);
+    for (size_t i = 0; i < n; i++) {
+        out.allocs += rtl::atomic_load(&c[i]->allocs);
+        out.frees += rtl::atomic_load(&c[i]->frees);
+        out.live_bytes += rtl::atomic_load(&c[i]->pending);
+        for (size_t b = 0; b < rtl::kTelemetryBuckets; b++) {
+            out.histogram[b] += rtl::atomic_load(&c[i]->histogram[b]);
+        }
+    }
+    out.peak_bytes = rtl::atomic_load(&t.peak);
+    if (out.peak_bytes < out.live_bytes) {
+        out.peak_bytes = out.live_bytes;
+    }
+}
+
+void Print(const char* name, const rtl::telemetry_counters& c) {
+    TELEMETRY_PRINT("krtl: %-16s allocs %lld frees %lld live %lld peak %lld\n", name, c.allocs, c.frees,
+                    c.live_bytes, c.peak_bytes);
+}
+
+const char* const kTagNames[kPoolTagCount] = {"Paged", "NonPaged", "NonPagedExecute", "NonPagedNx"};
+const char* const kKindNames[rtl::kAllocKindCount] = {"other", "vector", "list", "string", "hash_map"};
+
+#if _KRTL_TELEMETRY >= 2
+
+//
+// Debug mode: every allocation carries a header linking it into a list of
+// live allocations together with its call stack. Stacks are also aggregated
+// in a small open-addressing table for the hot-site report.
+//
+// Paged blocks are only allocated below DISPATCH_LEVEL and their headers may
+// be paged out, so they are listed under a lock held at APC_LEVEL. Blocks of
+// the other tags may be allocated at DISPATCH_LEVEL and are listed under a
+// lock held there, as is the (static, nonpaged) site table. The list and
+// site locks are never held together.
+//
+using Stack = const void* [rtl::kTelemetrySiteFrames];
+
+struct Header {
+    ListEntry link;
+    Stack site;
+    size_t size;
+    PoolTag tag;
+};
+
+constexpr size_t kHeaderSize = (sizeof(Header) + 15) & ~size_t(15);
+constexpr size_t kSiteCount = 1024;  // must be a power of 2
+
+// telemetry_allocate's own frame (CaptureStack skips its own)
+constexpr size_t kSkipFrames = 1;
+
+struct Site {
+    Stack site;
+    bool used;
+    long long allocs;
+    long long live_bytes;
+};
+
+rtl::apc_lock paged_lock;
+rtl::dispatch_lock nonpaged_lock;
+ListEntry live_lists[kPoolTagCount];
+
+rtl::dispatch_lock site_lock;
+Site sites[kSiteCount];
+
+/// @brief holds the lock of the live list of tag
+class LiveGuard {
+   public:
+    explicit LiveGuard(PoolTag tag) : paged_(tag == PoolTag::Paged) {
+        if (paged_) {
+            paged_lock.lock();
+        } else {
+            nonpaged_lock.lock();
+        }
+    }
+
+    ~LiveGuard() {
+        if (paged_) {
+            paged_lock.unlock();
+        } else {
+            nonpaged_lock.unlock();
+        }
+    }
+
+    LiveGuard(const LiveGuard&) = delete;
+    LiveGuard& operator=(const LiveGuard&) = delete;
+
+   private:
+    bool paged_;
+};
+
+/// @brief entry for site (site_lock held), nullptr when the table is full
+Site* FindSite(const Stack& site) {
+    size_t h = 0;
+    for (const void* frame : site) {
+        h = (h ^ (reinterpret_cast<size_t>(frame) >> 4)) * 0x9e3779b1u;
+    }
+    size_t i = h & (kSiteCount - 1);
+    for (size_t probe = 0; probe < kSiteCount; probe++, i = (i + 1) & (kSiteCount - 1)) {
+        if (!sites[i].used) {
+            memcpy(sites[i].site, site, sizeof(Stack));
+            sites[i].used = true;
+            return &sites[i];
+        }
+        if (memcmp(sites[i].site, site, sizeof(Stack)) == 0) {
+            return &sites[i];
+        }
+    }
+    return nullptr;  // table full, site not tracked
+}
+
+void AccountSite(const Stack& site, long long allocs, long long bytes) {
+    rtl::lock_guard<rtl::dispatch_lock> guard(site_lock);
+    if (Site* s = FindSite(site)) {
+        s->allocs += allocs;
+        s->live_bytes += bytes;
+    }
+}
+
+/// @brief header space in front of a block, a multiple of align (a power of 2)
+/// so the block keeps the alignment of the slab block below it
+size_t HeaderOffset(size_t align) {
+    return (kHeaderSize + align - 1) & ~(align - 1);
+}
+
+void* Track(void* p, size_t n, PoolTag tag, const Stack& site, size_t offset) {
+    if (p == nullptr) {
+        return nullptr;
+    }
+
+    p = static_cast<char*>(p) + offset;
+    Header* h = reinterpret_cast<Header*>(static_cast<char*>(p) - kHeaderSize);
+    memcpy(h->site, site, sizeof(Stack));
+    h->size = n;
+    h->tag = tag;
+
+    {
+        LiveGuard guard(tag);
+        InsertTailList(&live_lists[static_cast<size_t>(tag)], &h->link);
+    }
+    AccountSite(site, 1, static_cast<long long>(n));
+    return p;
+}
+
+void* Untrack(void* p, size_t offset) {
+    Header* h = reinterpret_cast<Header*>(static_cast<char*>(p) - kHeaderSize);
+    Stack site;
+    memcpy(site, h->site, sizeof(Stack));
+    size_t size = h->size;
+
+    {
+        LiveGuard guard(h->tag);
+        RemoveEntryList(&h->link);
+    }
+    AccountSite(site, 0, -static_cast<long long>(size));
+    return static_cast<char*>(p) - offset;
+}
+
+#endif
+
+}  // namespace
+
+void* rtl::telemetry_allocate(size_t n, PoolTag tag, size_t align) {
+#if _KRTL_TELEMETRY >= 2
+    Stack site = {};
+    CaptureStack(kSkipFrames, site, kTelemetrySiteFrames);
+    size_t offset = HeaderOffset(align);
+    void* p = Track(slab_allocate(n + offset, tag, align), n, tag, site, offset);
+#else
+    void* p = slab_allocate(n, tag, align);
+#endif
+    if (p) {
+        Counters& c = slots[CurrentSlot() % kSlots].tag[static_cast<size_t>(tag)];
+        rtl::atomic_add(&c.histogram[HistogramBucket(n)], 1);
+        Account(c, tag_totals[static_cast<size_t>(tag)], 1, static_cast<long long>(n));
+    }
+    return p;
+}
+
+void rtl::telemetry_deallocate(void* p, size_t n, PoolTag tag, size_t align) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    Account(slots[CurrentSlot() % kSlots].tag[static_cast<size_t>(tag)], tag_totals[static_cast<size_t>(tag)], -1,
+            -static_cast<long long>(n));
+#if _KRTL_TELEMETRY >= 2
+    size_t offset = HeaderOffset(align);
+    slab_deallocate(Untrack(p, offset), n + offset, tag, align);
+#else
+    slab_deallocate(p, n, tag, align);
+#endif
+}
+
+void rtl::telemetry_container(alloc_kind kind, long long count, long long bytes) noexcept {
+    Counters& c = slots[CurrentSlot() % kSlots].kind[static_cast<size_t>(kind)];
+    if (count > 0) {
+        rtl::atomic_add(&c.histogram[HistogramBucket(static_cast<size_t>(bytes))], 1);
+    }
+    Account(c, kind_totals[static_cast<size_t>(kind)], count, count > 0 ? bytes : -bytes);
+}
+
+void rtl::telemetry_snapshot(telemetry_stats& stats) {
+    const Counters* c[kSlots];
+    for (size_t t = 0; t < kPoolTagCount; t++) {
+        for (size_t i = 0; i < kSlots; i++) {
+            c[i] = &slots[i].tag[t];
+        }
+        Sum(stats.tag[t], c, kSlots, tag_totals[t]);
+    }
+    for (size_t k = 0; k < kAllocKindCount; k++) {
+        for (size_t i = 0; i < kSlots; i++) {
+            c[i] = &slots[i].kind[k];
+        }
+        Sum(stats.kind[k], c, kSlots, kind_totals[k]);
+    }
+}
+
+void rtl::telemetry_for_each_live(telemetry_callback callback, void* context) {
+#if _KRTL_TELEMETRY >= 2
+    for (size_t t = 0; t < kPoolTagCount; t++) {
+        LiveGuard guard(static_cast<PoolTag>(t));
+        for (ListEntry* e = live_lists[t].next; e != &live_lists[t]; e = e->next) {
+            Header* h = reinterpret_cast<Header*>(e);
+            callback(context, h->site, h->size, h->tag);
+        }
+    }
+#else
+    (void)callback;
+    (void)context;
+#endif
+}
+
+void rtl::telemetry_dump() {
+    telemetry_stats stats;
+    telemetry_snapshot(stats);
+    for (size_t t = 0; t < kPoolTagCount; t++) {
+        Print(kTagNames[t], stats.tag[t]);
+    }
+    for (size_t k = 0; k < kAllocKindCount; k++) {
+        Print(kKindNames[k], stats.kind[k]);
+    }
+
+#if _KRTL_TELEMETRY >= 2
+    rtl::lock_guard<rtl::dispatch_lock> guard(site_lock);
+    for (const Site& s : sites) {
+        if (s.used && s.live_bytes) {
+            TELEMETRY_PRINT("krtl: site allocs %lld live %lld\n", s.allocs, s.live_bytes);
+            for (const void* frame : s.site) {
+                if (frame) {
+                    TELEMETRY_PRINT("krtl:   %p\n", frame);
+                }
+            }
+        }
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/// @file Allocation telemetry per PoolTag and per container type
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <cstddef>
+
+#include "new.h"
+
+//
+// _KRTL_TELEMETRY selects the instrumentation level:
+//   0 - disabled, every hook compiles away (default)
+//   1 - per-CPU counters: allocations, frees, live and peak bytes, size histogram
+//   2 - as 1, plus a header on each allocation recording its call stack
+//       (kTelemetrySiteFrames return addresses), for leak reports and
+//       per-site totals
+//
+#ifndef _KRTL_TELEMETRY
+#define _KRTL_TELEMETRY 0
+#endif
+
+namespace rtl {
+
+enum class alloc_kind {
+    other,
+    vector,
+    list,
+    string,
+    hash_map,
+};
+
+constexpr size_t kAllocKindCount = 5;
+
+// histogram bucket i counts requests of at most (16 << i) bytes, the last one the rest
+constexpr size_t kTelemetryBuckets = 13;
+
+struct telemetry_counters {
+    long long allocs;
+    long long frees;
+    long long live_bytes;
+    long long peak_bytes;
+    long long histogram[kTelemetryBuckets];
+};
+
+struct telemetry_stats {
+    telemetry_counters tag[kPoolTagCount];
+    telemetry_counters kind[kAllocKindCount];
+};
+
+/// @brief sum the per-CPU counters (peaks are exact to within one batch per CPU)
+void telemetry_snapshot(telemetry_stats& stats);
+
+/// @brief print the totals (and, at level 2, live allocations by site)
+void telemetry_dump();
+
+// return addresses recorded per allocation, innermost first. The library's
+// own frames (allocator, container growth) come first, so several are kept
+// to reach the code that called into the container.
+constexpr size_t kTelemetrySiteFrames = 8;
+
+/// @brief enumerate live allocations (level 2 only). site holds
+/// kTelemetrySiteFrames return addresses, null past the end of the stack.
+/// The callback runs with a lock held at APC_LEVEL (Paged) or
+/// DISPATCH_LEVEL (other tags).
+using telemetry_callback = void (*)(void* context, const void* const* site, size_t bytes, PoolTag tag);
+void telemetry_for_each_live(telemetry_callback callback, void* context);
+
+//
+// hooks, used through rtl::allocator and the _RTL_TRACK_CONTAINER macro
+//
+void* telemetry_allocate(size_t n, PoolTag tag, size_t align = kPoolAlignment);
+void telemetry_deallocate(void* p, size_t n, PoolTag tag, size_t align = kPoolAlignment) noexcept;
+
+/// @param count - +1 per allocation, -n when n blocks are released
+/// @param bytes - total size of those blocks
+void telemetry_container(alloc_kind kind, long long count, long long bytes) noexcept;
+
+}  // namespace rtl
+
+#if _KRTL_TELEMETRY
+#define _RTL_TRACK_CONTAINER(kind, count, bytes) \
+    ::rtl::telemetry_container(::rtl::alloc_kind::kind, (count), static_cast<long long>(bytes))
+#else
+#define _RTL_TRACK_CONTAINER(kind, count, bytes) ((void)0)
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+/// @file arena and arena_allocator tests (user mode)
+#include "arena.h"
+#include "slab.h"
+#include "test/test.h"
+#include "unordered_map.h"
+
+static_assert(rtl::is_trivially_destructible_v<rtl::pair<int, int>>, "pair of trivial types");
+static_assert(rtl::is_trivially_copyable_v<rtl::pair<int, int>>, "pair of trivial types");
+static_assert(rtl::is_trivially_destructible_v<rtl::pair<const int, int>>, "map value of trivial types");
+
+namespace {
+
+void test_map_on_arena() {
+    rtl::arena a;
+    using Alloc = rtl::arena_allocator<rtl::pair<int, int>>;
+    rtl::unordered_map<int, int, rtl::hash<int>, rtl::equal_to<int>, Alloc> m{Alloc(a)};
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 1000; i++) {
+            m[i] = i * 2;
+        }
+        RTL_CHECK(m.size() == 1000);
+        RTL_CHECK(m.find(500) != m.end() && m.find(500)->second == 1000);
+        m.clear();
+        RTL_CHECK(m.size() == 0 && m.find(500) == m.end());
+    }
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_map_on_arena();
+    rtl::slab_uninitialize();
+    printf("arena_test: ok\n");
+    return 0;
+}
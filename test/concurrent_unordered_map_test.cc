@@ -0,0 +1,160 @@
+/// @file concurrent_unordered_map stress tests (user mode, one std::thread
+/// per writer and reader)
+#include <thread>
+#include <vector>
+
+#include "concurrent_unordered_map.h"
+#include "slab.h"
+#include "test/test.h"
+
+namespace {
+
+using map_type = rtl::concurrent_unordered_map<uint64_t, uint64_t>;
+
+constexpr size_t kWriters = 4;
+constexpr uint64_t kKeysPerWriter = 20000;
+constexpr size_t kRounds = 3;
+
+/// values are always key * 3 or key * 3 + 1, anything else is a torn or freed node
+bool valid(uint64_t key, uint64_t value) {
+    return value == key * 3 || value == key * 3 + 1;
+}
+
+/// each writer owns keys w, w + kWriters, ... and knows exactly which are present
+void writer(map_type& map, size_t w, std::vector<char>& present) {
+    for (size_t round = 0; round < kRounds; round++) {
+        for (uint64_t i = 0; i < kKeysPerWriter; i++) {
+            uint64_t key = i * kWriters + w;
+            switch ((i + round) % 4) {
+                case 0:
+                case 1:
+                    if (map.insert(key, key * 3)) {
+                        RTL_CHECK(!present[i]);
+                        present[i] = 1;
+                    } else {
+                        RTL_CHECK(present[i]);
+                    }
+                    break;
+                case 2:
+                    RTL_CHECK(map.insert_or_assign(key, key * 3 + 1) == !present[i]);
+                    present[i] = 1;
+                    break;
+                case 3:
+                    RTL_CHECK(map.erase(key) == size_t(present[i]));
+                    present[i] = 0;
+                    break;
+            }
+
+            uint64_t value = 0;
+            RTL_CHECK(map.find(key, value) == bool(present[i]));
+            RTL_CHECK(!present[i] || valid(key, value));
+        }
+    }
+}
+
+void reader(map_type& map, const volatile bool& stop) {
+    while (!stop) {
+        for (uint64_t key = 0; key < kKeysPerWriter * kWriters && !stop; key++) {
+            map.visit(key, [key](const uint64_t& value) { RTL_CHECK(valid(key, value)); });
+        }
+    }
+}
+
+void test_stress() {
+    map_type map;
+    std::vector<std::vector<char>> present(kWriters, std::vector<char>(kKeysPerWriter));
+    volatile bool stop = false;
+
+    std::thread readers[2] = {std::thread(reader, std::ref(map), std::cref(stop)),
+                              std::thread(reader, std::ref(map), std::cref(stop))};
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < kWriters; w++) {
+        writers.emplace_back(writer, std::ref(map), w, std::ref(present[w]));
+    }
+    for (auto& t : writers) {
+        t.join();
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    size_t expected = 0;
+    for (size_t w = 0; w < kWriters; w++) {
+        for (uint64_t i = 0; i < kKeysPerWriter; i++) {
+            uint64_t key = i * kWriters + w;
+            expected += present[w][i];
+            RTL_CHECK(map.contains(key) == bool(present[w][i]));
+        }
+    }
+    RTL_CHECK(map.size() == expected);
+    RTL_CHECK(map.bucket_count() >= expected);
+
+    map.clear();
+    RTL_CHECK(map.empty() && !map.contains(0));
+    map.quiesce();
+}
+
+/// retire() must not wait for readers, the caller's own section included
+void test_erase_inside_visit() {
+    map_type map;
+    for (uint64_t key = 0; key < 1000; key++) {
+        map.insert(key, key * 3);
+    }
+    for (uint64_t key = 0; key < 1000; key++) {
+        RTL_CHECK(map.visit(key, [&map, key](const uint64_t& value) {
+            RTL_CHECK(valid(key, value));
+            RTL_CHECK(map.erase(key) == 1);
+            RTL_CHECK(map.insert(key + 1000000, 0));
+        }));
+    }
+    RTL_CHECK(map.size() == 1000);
+    map.quiesce();
+}
+
+/// keys present before growth starts stay visible to readers while the
+/// stripes move to the new bucket arrays one by one
+void test_growth_keeps_keys() {
+    constexpr uint64_t kResident = 1000;
+    constexpr uint64_t kGrowth = 100000;
+    map_type map;
+    for (uint64_t key = 0; key < kResident; key++) {
+        map.insert(key, key * 3);
+    }
+
+    volatile bool stop = false;
+    auto check = [&map, &stop]() {
+        while (!stop) {
+            for (uint64_t key = 0; key < kResident; key++) {
+                RTL_CHECK(map.visit(key, [key](const uint64_t& value) { RTL_CHECK(valid(key, value)); }));
+            }
+        }
+    };
+    std::thread readers[2] = {std::thread(check), std::thread(check)};
+    for (uint64_t key = kResident; key < kResident + kGrowth; key++) {
+        RTL_CHECK(map.insert(key, key * 3));
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    RTL_CHECK(map.size() == kResident + kGrowth);
+    RTL_CHECK(map.bucket_count() >= kResident + kGrowth);
+    for (uint64_t key = 0; key < kResident + kGrowth; key++) {
+        RTL_CHECK(map.contains(key));
+    }
+    map.quiesce();
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_erase_inside_visit();
+    test_stress();
+    test_growth_keeps_keys();
+    rtl::slab_uninitialize();
+    printf("concurrent_unordered_map_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+/// @file flat_hash_map tests (user mode)
+#include "flat_hash_map.h"
+#include "slab.h"
+#include "test/test.h"
+
+namespace {
+
+int g_values_built = 0;
+int g_values_destroyed = 0;
+
+// counts every value constructed or destroyed
+struct Counted {
+    int value = 0;
+
+    Counted() { g_values_built++; }
+    Counted(int v) : value(v) { g_values_built++; }
+    Counted(const Counted& other) : value(other.value) { g_values_built++; }
+    Counted(Counted&& other) : value(other.value) { g_values_built++; }
+    ~Counted() { g_values_destroyed++; }
+    Counted& operator=(const Counted& other) = default;
+};
+
+using Map = rtl::flat_hash_map<int, Counted>;
+
+void reset_counts() {
+    g_values_built = 0;
+    g_values_destroyed = 0;
+}
+
+void test_hit_builds_nothing() {
+    Map m;
+    for (int i = 0; i < 100; i++) {
+        m.try_emplace(i, i);
+    }
+
+    reset_counts();
+    for (int i = 0; i < 100; i++) {
+        RTL_CHECK(!m.try_emplace(i, -1).second);
+        RTL_CHECK(!m.emplace(i, -1).second);
+        RTL_CHECK(m[i].value == i);
+    }
+    RTL_CHECK(g_values_built == 0);
+    RTL_CHECK(g_values_destroyed == 0);
+}
+
+void test_miss_builds_in_place() {
+    Map m;
+    m.reserve(8);
+    reset_counts();
+    auto ret = m.try_emplace(7, 70);
+    RTL_CHECK(ret.second && ret.first->second.value == 70);
+    RTL_CHECK(g_values_built == 1);
+    RTL_CHECK(g_values_destroyed == 0);
+
+    reset_counts();
+    m[8].value = 80;
+    RTL_CHECK(g_values_built == 1);
+    RTL_CHECK(m.find(8) != m.end() && m.find(8)->second.value == 80);
+    RTL_CHECK(m.size() == 2);
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_hit_builds_nothing();
+    test_miss_builds_in_place();
+    rtl::slab_uninitialize();
+    printf("flat_hash_map_test: ok\n");
+    return 0;
+}
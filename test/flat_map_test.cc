@@ -0,0 +1,131 @@
+/// @file flat_map tests (user mode)
+#include <limits.h>
+#include <stdint.h>
+
+#include "flat_map.h"
+#include "slab.h"
+#include "test/test.h"
+
+namespace {
+
+uint64_t g_state = 0x853C49E6748FEA9Bull;
+
+uint64_t next_random() {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return g_state;
+}
+
+/// index of the first of keys[0, n) not less than key
+template <class K>
+size_t lower_ref(const K* keys, size_t n, K key) {
+    size_t i = 0;
+    while (i < n && keys[i] < key) {
+        i++;
+    }
+    return i;
+}
+
+/// keys spread over the whole range, the sign boundary included
+template <class K>
+K random_key() {
+    static const K kEdges[] = {K(0), K(1), K(-1), K(-2), static_cast<K>(INT32_MIN), static_cast<K>(INT32_MAX),
+                               static_cast<K>(INT32_MIN + 1), static_cast<K>(0x80000000u), static_cast<K>(0x7fffffffu)};
+    if (next_random() % 4 == 0) {
+        return kEdges[next_random() % (sizeof(kEdges) / sizeof(kEdges[0]))];
+    }
+    return static_cast<K>(next_random());
+}
+
+/// lower_bound and find against a linear scan, for maps up to and past the
+/// size scanned with SSE2 (32), for 32-bit keys of either signedness and for
+/// 64-bit keys, which always take the branchless search
+template <class K>
+void test_lower_bound() {
+    for (size_t n = 0; n <= 70; n++) {
+        for (size_t round = 0; round < 20; round++) {
+            rtl::flat_map<K, int> map;
+            while (map.size() < n) {
+                map.try_emplace(random_key<K>(), 0);
+            }
+            const K* keys = map.keys().data();
+            for (size_t i = 1; i < n; i++) {
+                RTL_CHECK(keys[i - 1] < keys[i]);
+            }
+
+            for (size_t q = 0; q < 40; q++) {
+                K key = q < n ? keys[q] : random_key<K>();
+                if (q % 3 == 1) {
+                    key = static_cast<K>(static_cast<uint64_t>(key) + 1);  // wraps
+                }
+                size_t expected = lower_ref(keys, n, key);
+                RTL_CHECK(map.lower_bound(key) == map.begin() + expected);
+                bool present = expected < n && keys[expected] == key;
+                RTL_CHECK(map.contains(key) == present);
+                RTL_CHECK((map.find(key) != map.end()) == present);
+            }
+        }
+    }
+}
+
+/// insert(first, last): existing keys win over the range, and within the
+/// range the first of equal keys wins, however large the range
+void test_bulk_insert_keeps_first() {
+    const size_t sizes[] = {0, 5, 16, 17, 100, 1000};  // around kSortRun and past a merge
+    for (size_t n : sizes) {
+        rtl::flat_map<int, int> map;
+        for (int key = 0; key < 50; key += 5) {
+            map.try_emplace(key, -1);
+        }
+
+        rtl::vector<rtl::pair<int, int>> items;
+        for (size_t i = 0; i < n; i++) {
+            items.emplace_back(static_cast<int>(next_random() % 64), static_cast<int>(i));
+        }
+        map.insert(items.begin(), items.end());
+
+        for (int key = 0; key < 64; key++) {
+            int expected = INT_MIN;
+            if (key % 5 == 0 && key < 50) {
+                expected = -1;
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    if (items[i].first == key) {
+                        expected = items[i].second;
+                        break;
+                    }
+                }
+            }
+
+            auto it = map.find(key);
+            if (expected == INT_MIN) {
+                RTL_CHECK(it == map.end());
+            } else {
+                RTL_CHECK(it != map.end() && it->second == expected);
+            }
+        }
+        for (size_t i = 1; i < map.size(); i++) {
+            RTL_CHECK(map.keys()[i - 1] < map.keys()[i]);
+        }
+    }
+
+    // the range constructor
+    rtl::pair<int, int> items[] = {{3, 0}, {1, 1}, {3, 2}, {2, 3}, {1, 4}};
+    rtl::flat_map<int, int> map(items, items + 5);
+    RTL_CHECK(map.size() == 3);
+    RTL_CHECK(map.find(1)->second == 1 && map.find(2)->second == 3 && map.find(3)->second == 0);
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_lower_bound<int32_t>();
+    test_lower_bound<uint32_t>();
+    test_lower_bound<int64_t>();
+    test_bulk_insert_keeps_first();
+    rtl::slab_uninitialize();
+    printf("flat_map_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+/// @file frozen_map_view tests (user mode)
+#include "frozen_map.h"
+#include "slab.h"
+#include "test/test.h"
+
+namespace {
+
+using view_type = rtl::frozen_map_view<uint32_t, uint32_t>;
+
+void build(rtl::vector<unsigned char>& image) {
+    rtl::unordered_map<uint32_t, uint32_t> map;
+    for (uint32_t i = 0; i < 100; i++) {
+        map[i] = i * 7;
+    }
+    rtl::freeze(map, image);
+}
+
+void test_round_trip() {
+    rtl::vector<unsigned char> image;
+    build(image);
+    view_type view(image.data(), image.size());
+    RTL_CHECK(view.valid() && view.size() == 100);
+    for (uint32_t i = 0; i < 100; i++) {
+        auto it = view.find(i);
+        RTL_CHECK(it != view.end() && it->second == i * 7);
+    }
+    RTL_CHECK(view.find(100) == view.end());
+}
+
+/// offsets near UINT64_MAX must not wrap past the size checks
+void test_rejects_wrapping_offsets() {
+    rtl::vector<unsigned char> image;
+    build(image);
+    const size_t fields[] = {offsetof(rtl::frozen_header, starts_offset), offsetof(rtl::frozen_header, hashes_offset),
+                             offsetof(rtl::frozen_header, entries_offset)};
+    for (size_t field : fields) {
+        rtl::vector<unsigned char> copy;
+        copy.append(image.data(), image.data() + image.size());
+        uint64_t offset = UINT64_MAX - 7;  // aligned for every table, wraps when a length is added
+        memcpy(copy.data() + field, &offset, sizeof(offset));
+        view_type view(copy.data(), copy.size());
+        RTL_CHECK(!view.valid());
+        RTL_CHECK(view.find(1) == view.end());
+    }
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_round_trip();
+    test_rejects_wrapping_offsets();
+    rtl::slab_uninitialize();
+    printf("frozen_map_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+/// @file static_map tests (user mode); the tables are built at compile time
+#include <stdint.h>
+
+#include "slab.h"
+#include "static_map.h"
+#include "test/test.h"
+
+namespace {
+
+constexpr auto kCommands = rtl::make_static_map<rtl::string_view, int>({
+    {"open", 1},
+    {"close", 2},
+    {"read", 3},
+    {"write", 4},
+    {"", 5},
+    {"seek", 6},
+    {"openat", 7},
+    {"o", 8},
+    {"reopen", 9},
+});
+
+constexpr auto kWideCommands = rtl::make_static_map<rtl::wstring_view, int>({
+    {L"open", 1},
+    {L"close", 2},
+    {L"été", 3},
+    {L"OPEN", 4},
+});
+
+constexpr auto kSingle = rtl::make_static_map<int, int>({{42, 1}});
+
+constexpr rtl::static_map_entry<uint32_t, uint32_t> kCodeItems[] = {
+    {0, 0},           {1, 1},           {2, 2},           {0xc0000005u, 3}, {0xc0000022u, 4},
+    {0x80000005u, 5}, {0xffffffffu, 6}, {0x7fffffffu, 7}, {1000, 8},        {1001, 9},
+    {1002, 10},       {4096, 11},       {8192, 12},       {65536, 13},      {0x10000001u, 14},
+    {77, 15},         {78, 16},         {79, 17},
+};
+constexpr auto kCodes = rtl::make_static_map(kCodeItems);
+
+// the constructor runs at compile time
+static_assert(kCommands.size() == 9 && kCodes.size() == 18, "unexpected sizes");
+
+template <class Map, class K, class V>
+void check(const Map& map, K key, V value) {
+    auto it = map.find(key);
+    RTL_CHECK(it != map.end() && it->second == value);
+    RTL_CHECK(map.contains(key));
+}
+
+void test_string_keys() {
+    for (const auto& entry : kCommands) {
+        check(kCommands, entry.first, entry.second);
+    }
+    const char* misses[] = {"ope", "opens", "OPEN", "clos", "closer", "x", "reads", "wr1te", "seekk", "pen"};
+    for (const char* key : misses) {
+        RTL_CHECK(kCommands.find(key) == kCommands.end() && !kCommands.contains(key));
+    }
+
+    // keys that are not null-terminated where they sit
+    const char text[] = "reopen";
+    check(kCommands, rtl::string_view(text + 2, 4), 1);
+    check(kCommands, rtl::string_view(text, 6), 9);
+    RTL_CHECK(!kCommands.contains(rtl::string_view(text, 5)));
+}
+
+void test_wide_keys() {
+    for (const auto& entry : kWideCommands) {
+        check(kWideCommands, entry.first, entry.second);
+    }
+    RTL_CHECK(!kWideCommands.contains(L"Open"));
+    RTL_CHECK(!kWideCommands.contains(L"étè"));
+    RTL_CHECK(!kWideCommands.contains(L""));
+}
+
+void test_integer_keys() {
+    for (const auto& entry : kCodes) {
+        check(kCodes, entry.first, entry.second);
+    }
+    size_t misses = 0;
+    for (uint32_t key = 3; key < 100000; key += 7) {
+        bool present = false;
+        for (const auto& entry : kCodeItems) {
+            present |= entry.first == key;
+        }
+        RTL_CHECK(kCodes.contains(key) == present);
+        misses += !present;
+    }
+    RTL_CHECK(misses > 0);
+    RTL_CHECK(!kCodes.contains(0xc0000006u) && !kCodes.contains(0xfffffffeu));
+
+    check(kSingle, 42, 1);
+    RTL_CHECK(!kSingle.contains(0) && !kSingle.contains(43) && !kSingle.contains(-42));
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_string_keys();
+    test_wide_keys();
+    test_integer_keys();
+    rtl::slab_uninitialize();
+    printf("static_map_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,279 @@
+/// @file string_simd tests against scalar references (user mode). Build once
+/// as usual and once with -D_RTL_NO_AVX2 to cover the SSE2 kernels as well.
+#include <stdint.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "slab.h"
+#include "string_simd.h"
+#include "test/test.h"
+
+namespace {
+
+uint64_t g_state = 0x9E3779B97F4A7C15ull;
+
+uint64_t next_random() {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return g_state;
+}
+
+size_t random_below(size_t n) {
+    return n ? static_cast<size_t>(next_random() % n) : 0;
+}
+
+// letters at the edges of the ASCII ranges, their neighbours, bytes >= 0x80
+// (negative as char) and, for wchar_t, values whose low byte is a letter
+template <class E>
+E random_char() {
+    static const unsigned kChars[] = {'a',  'b',  'z',  'A',  'B',  'Z',  '@',  '[',  '`',  '{',
+                                      '0',  ' ',  0x7f, 0x80, 0xc1, 0xe1, 0xda, 0xfa, 0xff, 0x01};
+    static const unsigned kWide[] = {0x141, 0x161, 0x17a, 0xff41, 0xff21, 0x10061, 0x7fffffff};
+    size_t n = sizeof(kChars) / sizeof(kChars[0]);
+    if (sizeof(E) > 1 && random_below(4) == 0) {
+        return static_cast<E>(kWide[random_below(sizeof(kWide) / sizeof(kWide[0]))]);
+    }
+    return static_cast<E>(kChars[random_below(n)]);
+}
+
+template <class E>
+void random_string(E* s, size_t n, size_t alphabet = 0) {
+    for (size_t i = 0; i < n; i++) {
+        s[i] = alphabet ? static_cast<E>('a' + random_below(alphabet)) : random_char<E>();
+    }
+}
+
+//
+// scalar references
+//
+template <class E>
+long long order_of(E c) {
+    return sizeof(E) == 1 ? static_cast<long long>(static_cast<unsigned char>(c)) : static_cast<long long>(c);
+}
+
+template <class E>
+E to_lower(E c) {
+    return c >= E('A') && c <= E('Z') ? static_cast<E>(c + ('a' - 'A')) : c;
+}
+
+template <class E>
+E to_upper(E c) {
+    return c >= E('a') && c <= E('z') ? static_cast<E>(c - ('a' - 'A')) : c;
+}
+
+template <class E>
+int compare_ref(const E* x, size_t nx, const E* y, size_t ny, bool icase) {
+    for (size_t i = 0; i < nx && i < ny; i++) {
+        long long a = order_of(icase ? to_lower(x[i]) : x[i]);
+        long long b = order_of(icase ? to_lower(y[i]) : y[i]);
+        if (a != b) {
+            return a < b ? -1 : 1;
+        }
+    }
+    return nx < ny ? -1 : nx > ny ? 1 : 0;
+}
+
+template <class E>
+size_t find_ref(const E* s, size_t n, const E* sub, size_t m) {
+    for (size_t i = 0; i + m <= n; i++) {
+        if (memcmp(s + i, sub, m * sizeof(E)) == 0) {
+            return i;
+        }
+    }
+    return rtl::kStrNotFound;
+}
+
+int sign(int v) {
+    return v < 0 ? -1 : v > 0 ? 1 : 0;
+}
+
+constexpr size_t kMaxLength = 100;  // past 3 AVX2 blocks of char
+constexpr size_t kMaxOffset = 33;   // every start within a 32 byte block
+
+//
+// tests
+//
+template <class E>
+void test_length() {
+    E buffer[kMaxOffset + kMaxLength + 1];
+    for (size_t offset = 0; offset < kMaxOffset; offset++) {
+        for (size_t n = 0; n < kMaxLength; n++) {
+            E* s = buffer + offset;
+            for (size_t i = 0; i < n; i++) {
+                E c = random_char<E>();
+                s[i] = c != E() ? c : E('x');
+            }
+            s[n] = E();
+            RTL_CHECK(rtl::str_length(s) == n);
+        }
+    }
+}
+
+/// the aligned over-read of str_length must stop at the terminator's page
+template <class E>
+void test_length_at_page_end() {
+#if !defined(_WIN32)
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    char* base = static_cast<char*>(mmap(nullptr, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    RTL_CHECK(base != MAP_FAILED);
+    RTL_CHECK(mprotect(base + page, page, PROT_NONE) == 0);
+
+    E* end = reinterpret_cast<E*>(base + page) - 1;  // the terminator's slot
+    for (size_t n = 0; n < kMaxLength; n++) {
+        E* s = end - n;
+        for (size_t i = 0; i < n; i++) {
+            s[i] = E('a' + i % 26);
+        }
+        *end = E();
+        RTL_CHECK(rtl::str_length(s) == n);
+    }
+
+    // a string starting right at the page start
+    E* first = reinterpret_cast<E*>(base);
+    size_t lanes = page / sizeof(E);
+    for (size_t i = 0; i + 1 < lanes; i++) {
+        first[i] = E('b');
+    }
+    first[lanes - 1] = E();
+    RTL_CHECK(rtl::str_length(first) == lanes - 1);
+
+    munmap(base, page * 2);
+#endif
+}
+
+template <class E>
+void test_find_char() {
+    E buffer[kMaxOffset + kMaxLength];
+    for (size_t round = 0; round < 20; round++) {
+        for (size_t offset = 0; offset < kMaxOffset; offset++) {
+            for (size_t n = 0; n < kMaxLength; n++) {
+                E* s = buffer + offset;
+                random_string(s, n);
+                E c = random_char<E>();
+                RTL_CHECK(rtl::str_find(s, n, c) == find_ref(s, n, &c, 1));
+            }
+        }
+    }
+}
+
+template <class E>
+void test_find_substring() {
+    E buffer[kMaxOffset + kMaxLength];
+    E sub[kMaxLength];
+    for (size_t round = 0; round < 20; round++) {
+        for (size_t offset = 0; offset < kMaxOffset; offset++) {
+            size_t n = random_below(kMaxLength);
+            E* s = buffer + offset;
+            size_t alphabet = round % 2 ? 2 : 0;  // two letters: many near matches
+            random_string(s, n, alphabet);
+
+            size_t m = random_below(12);
+            if (m <= n && random_below(2)) {
+                memcpy(sub, s + random_below(n - m + 1), m * sizeof(E));
+            } else {
+                random_string(sub, m, alphabet);
+            }
+            RTL_CHECK(rtl::str_find(s, n, sub, m) == find_ref(s, n, sub, m));
+        }
+    }
+
+    // only the last position matches
+    for (size_t n = 2; n < kMaxLength; n++) {
+        E* s = buffer + n % kMaxOffset;
+        for (size_t i = 0; i < n; i++) {
+            s[i] = E('a');
+        }
+        s[n - 1] = E('b');
+        E ab[2] = {E('a'), E('b')};
+        RTL_CHECK(rtl::str_find(s, n, ab, 2) == n - 2);
+        E bb[2] = {E('b'), E('b')};
+        RTL_CHECK(rtl::str_find(s, n, bb, 2) == rtl::kStrNotFound);
+    }
+}
+
+template <class E>
+void test_compare(bool icase) {
+    E x[kMaxOffset + kMaxLength];
+    E y[kMaxOffset + kMaxLength];
+    for (size_t round = 0; round < 10; round++) {
+        for (size_t n = 0; n < kMaxLength; n++) {
+            E* a = x + random_below(kMaxOffset);
+            E* b = y + random_below(kMaxOffset);
+            random_string(a, n);
+            for (size_t i = 0; i < n; i++) {
+                b[i] = icase && random_below(2) ? (random_below(2) ? to_upper(a[i]) : to_lower(a[i])) : a[i];
+            }
+
+            // equal, differing at one position, or one a prefix of the other
+            size_t nb = n;
+            switch (random_below(3)) {
+                case 1:
+                    if (n) {
+                        b[random_below(n)] = random_char<E>();
+                    }
+                    break;
+                case 2:
+                    nb = random_below(n + 1);
+                    break;
+            }
+            int expected = compare_ref(a, n, b, nb, icase);
+            if (icase) {
+                RTL_CHECK(sign(rtl::str_compare_icase(a, n, b, nb)) == expected);
+                RTL_CHECK(sign(rtl::str_compare_icase(b, nb, a, n)) == -expected);
+            } else {
+                RTL_CHECK(sign(rtl::str_compare(a, n, b, nb)) == expected);
+                RTL_CHECK(sign(rtl::str_compare(b, nb, a, n)) == -expected);
+            }
+        }
+    }
+}
+
+template <class E>
+void test_fold() {
+    E buffer[kMaxOffset + kMaxLength + 1];
+    E expected[kMaxLength];
+    for (size_t round = 0; round < 10; round++) {
+        for (size_t n = 0; n < kMaxLength; n++) {
+            bool upper = random_below(2);
+            E* s = buffer + random_below(kMaxOffset);
+            random_string(s, n);
+            s[n] = E('q');  // must stay as is
+            for (size_t i = 0; i < n; i++) {
+                expected[i] = upper ? to_upper(s[i]) : to_lower(s[i]);
+            }
+            if (upper) {
+                rtl::str_upper(s, n);
+            } else {
+                rtl::str_lower(s, n);
+            }
+            RTL_CHECK(memcmp(s, expected, n * sizeof(E)) == 0);
+            RTL_CHECK(s[n] == E('q'));
+        }
+    }
+}
+
+template <class E>
+void test_all() {
+    test_length<E>();
+    test_length_at_page_end<E>();
+    test_find_char<E>();
+    test_find_substring<E>();
+    test_compare<E>(false);
+    test_compare<E>(true);
+    test_fold<E>();
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_all<char>();
+    test_all<wchar_t>();
+    rtl::slab_uninitialize();
+    printf("string_simd_test: ok\n");
+    return 0;
+}
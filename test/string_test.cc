@@ -0,0 +1,250 @@
+/// @file basic_string tests against std::basic_string (user mode)
+#include <stdint.h>
+
+#include <string>
+
+#include "slab.h"
+#include "string.h"
+#include "test/test.h"
+
+namespace {
+
+uint64_t g_state = 0x2545F4914F6CDD1Dull;
+
+size_t random_below(size_t n) {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return n ? static_cast<size_t>(g_state % n) : 0;
+}
+
+/// the characters live in the object itself (short form)
+template <class S>
+bool is_inline(const S& s) {
+    const char* p = reinterpret_cast<const char*>(s.data());
+    const char* object = reinterpret_cast<const char*>(&s);
+    return p >= object && p < object + sizeof(S);
+}
+
+template <class S, class T>
+bool same(const S& s, const std::basic_string<T>& expected) {
+    return s.size() == expected.size() && s.capacity() >= s.size() && s.data()[s.size()] == T() &&
+           expected.compare(0, expected.size(), s.data(), s.size()) == 0;
+}
+
+template <class T>
+T letter(size_t i) {
+    return static_cast<T>('a' + i % 26);
+}
+
+template <class T>
+void test_short_long_short() {
+    using S = rtl::basic_string<T>;
+    S s;
+    std::basic_string<T> expected;
+    size_t short_capacity = s.capacity();
+    RTL_CHECK(is_inline(s) && s.size() == 0);
+
+    for (size_t i = 0; i < 200; i++) {
+        s.push_back(letter<T>(i));
+        expected.push_back(letter<T>(i));
+        RTL_CHECK(same(s, expected));
+        RTL_CHECK(is_inline(s) == (s.size() <= short_capacity));
+    }
+
+    // still long: shrinking keeps a heap buffer that is just big enough
+    s.resize_and_overwrite(100, [](T*, size_t) { return size_t(100); });
+    expected.resize(100);
+    s.shrink_to_fit();
+    RTL_CHECK(same(s, expected) && !is_inline(s) && s.capacity() < 200);
+
+    // back inline
+    s.resize_and_overwrite(short_capacity, [](T*, size_t n) { return n; });
+    expected.resize(short_capacity);
+    s.shrink_to_fit();
+    RTL_CHECK(same(s, expected) && is_inline(s) && s.capacity() == short_capacity);
+
+    s.clear();
+    s.shrink_to_fit();
+    RTL_CHECK(s.size() == 0 && is_inline(s) && s.data()[0] == T());
+
+    // and long again
+    s.append(expected.data(), expected.size());
+    s.append(expected.data(), expected.size());
+    expected += expected;
+    RTL_CHECK(same(s, expected) && !is_inline(s));
+}
+
+template <class T>
+void test_append_from_inside() {
+    using S = rtl::basic_string<T>;
+    for (size_t n = 1; n < 60; n++) {
+        for (size_t offset = 0; offset < n; offset++) {
+            S s;
+            std::basic_string<T> expected;
+            for (size_t i = 0; i < n; i++) {
+                s.push_back(letter<T>(i));
+                expected.push_back(letter<T>(i));
+            }
+            // with and without reallocation
+            s.append(s.data() + offset, n - offset);
+            expected.append(expected, offset, n - offset);
+            RTL_CHECK(same(s, expected));
+            s.reserve(s.size() * 2);
+            size_t size = s.size();
+            s.append(s.data() + offset, size - offset);
+            expected.append(expected, offset, size - offset);
+            RTL_CHECK(same(s, expected));
+        }
+    }
+}
+
+template <class T>
+void test_move_and_swap() {
+    using S = rtl::basic_string<T>;
+    std::basic_string<T> short_text(3, letter<T>(1));
+    std::basic_string<T> long_text(100, letter<T>(2));
+
+    for (int from_long = 0; from_long < 2; from_long++) {
+        for (int to_long = 0; to_long < 2; to_long++) {
+            const std::basic_string<T>& from_text = from_long ? long_text : short_text;
+            const std::basic_string<T>& to_text = to_long ? long_text : short_text;
+
+            S from(from_text.c_str());
+            S moved(static_cast<S&&>(from));
+            RTL_CHECK(same(moved, from_text) && from.size() == 0 && is_inline(from));
+
+            S to(to_text.c_str());
+            to = static_cast<S&&>(moved);
+            RTL_CHECK(same(to, from_text) && moved.size() == 0 && is_inline(moved));
+
+            S a(from_text.c_str());
+            S b(to_text.c_str());
+            a.swap(b);
+            RTL_CHECK(same(a, to_text) && same(b, from_text));
+            RTL_CHECK(is_inline(a) == !to_long && is_inline(b) == !from_long);
+
+            // still usable after all that
+            a.append(from_text.c_str());
+            b.push_back(letter<T>(0));
+            RTL_CHECK(same(a, to_text + from_text) && same(b, from_text + letter<T>(0)));
+        }
+    }
+}
+
+template <class T>
+void test_custom_inline_size() {
+    using S = rtl::basic_string<T, rtl::allocator<T>, 64>;
+    S s;
+    RTL_CHECK(s.capacity() >= 64 && sizeof(S) >= 64 * sizeof(T));
+    std::basic_string<T> expected;
+    for (size_t i = 0; i < s.capacity(); i++) {
+        s.push_back(letter<T>(i));
+        expected.push_back(letter<T>(i));
+    }
+    RTL_CHECK(same(s, expected) && is_inline(s));
+
+    s.push_back(letter<T>(0));
+    expected.push_back(letter<T>(0));
+    RTL_CHECK(same(s, expected) && !is_inline(s));
+
+    S copy(s);
+    RTL_CHECK(same(copy, expected) && copy == s);
+    rtl::basic_string<T> other(s);  // across N
+    RTL_CHECK(same(other, expected));
+}
+
+/// each character is copied O(1) times: the buffer at least doubles
+template <class T>
+void test_growth() {
+    rtl::basic_string<T> s;
+    size_t moves = 0;
+    const T* data = s.data();
+    for (size_t i = 0; i < 100000; i++) {
+        s.push_back(letter<T>(i));
+        if (s.data() != data) {
+            moves++;
+            data = s.data();
+        }
+    }
+    RTL_CHECK(s.size() == 100000 && moves <= 20);
+}
+
+/// random operations against std::basic_string
+template <class T>
+void test_random() {
+    using S = rtl::basic_string<T>;
+    S s;
+    std::basic_string<T> expected;
+    for (size_t step = 0; step < 20000; step++) {
+        switch (random_below(8)) {
+            case 0:
+            case 1: {
+                T c = letter<T>(random_below(26));
+                s.push_back(c);
+                expected.push_back(c);
+                break;
+            }
+            case 2: {
+                std::basic_string<T> text(random_below(40), letter<T>(step));
+                s.append(text.data(), text.size());
+                expected += text;
+                break;
+            }
+            case 3:
+                if (!expected.empty()) {
+                    size_t offset = random_below(expected.size());
+                    size_t n = random_below(expected.size() - offset + 1);
+                    s.append(s.data() + offset, n);
+                    expected.append(expected, offset, n);
+                }
+                break;
+            case 4: {
+                size_t n = random_below(expected.size() + 1);
+                s.resize_and_overwrite(n, [](T*, size_t n) { return n; });
+                expected.resize(n);
+                break;
+            }
+            case 5:
+                s.shrink_to_fit();
+                break;
+            case 6: {
+                S moved(static_cast<S&&>(s));
+                s = static_cast<S&&>(moved);
+                break;
+            }
+            case 7:
+                if (random_below(8) == 0) {
+                    s.clear();
+                    expected.clear();
+                }
+                break;
+        }
+        RTL_CHECK(same(s, expected));
+        if (expected.size() > 300) {
+            s.clear();
+            expected.clear();
+        }
+    }
+}
+
+template <class T>
+void test_all() {
+    test_short_long_short<T>();
+    test_append_from_inside<T>();
+    test_move_and_swap<T>();
+    test_custom_inline_size<T>();
+    test_growth<T>();
+    test_random<T>();
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_all<char>();
+    test_all<wchar_t>();
+    rtl::slab_uninitialize();
+    printf("string_test: ok\n");
+    return 0;
+}
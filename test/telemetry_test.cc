@@ -0,0 +1,61 @@
+/// @file telemetry tests (user mode), build with -D_KRTL_TELEMETRY=2:
+///   g++ -std=c++17 -O2 -pthread -D_KRTL_TELEMETRY=2 -iquote . test/telemetry_test.cc *.cc -o telemetry_test
+#include "slab.h"
+#include "test/test.h"
+#include "vector.h"
+
+static_assert(_KRTL_TELEMETRY >= 2, "build with -D_KRTL_TELEMETRY=2");
+
+namespace {
+
+/// @brief grows a vector, so the block is allocated a few library frames down
+__attribute__((noinline)) rtl::vector<int>* grow_here() {
+    auto* v = new rtl::vector<int>();
+    v->push_back(1);
+    __asm__ volatile("");  // keep the return address inside this function
+    return v;
+}
+
+struct SiteSearch {
+    const void* first;
+    const void* last;
+    bool found;
+};
+
+void find_site(void* context, const void* const* site, size_t, PoolTag) {
+    auto* search = static_cast<SiteSearch*>(context);
+    for (size_t i = 0; i < rtl::kTelemetrySiteFrames; i++) {
+        if (site[i] >= search->first && site[i] < search->last) {
+            search->found = true;
+        }
+    }
+}
+
+void test_site_is_the_caller() {
+    rtl::vector<int>* v = grow_here();
+    const char* fn = reinterpret_cast<const char*>(&grow_here);
+    SiteSearch search = {fn, fn + 512, false};
+    rtl::telemetry_for_each_live(find_site, &search);
+    RTL_CHECK(search.found);
+    delete v;
+}
+
+void test_aligned_blocks() {
+    const size_t aligns[] = {16, 32, 64, 128, 4096};
+    for (size_t align : aligns) {
+        void* p = rtl::telemetry_allocate(100, PoolTag::NonPaged, align);
+        RTL_CHECK(p && reinterpret_cast<size_t>(p) % align == 0);
+        rtl::telemetry_deallocate(p, 100, PoolTag::NonPaged, align);
+    }
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_site_is_the_caller();
+    test_aligned_blocks();
+    rtl::slab_uninitialize();
+    printf("telemetry_test: ok\n");
+    return 0;
+}
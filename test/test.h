@@ -0,0 +1,18 @@
+/// @file minimal checks for the user-mode tests, build each one from the
+/// repository root with
+///   g++ -std=c++17 -O2 -pthread -iquote . test/<name>.cc *.cc -o <name>
+#ifndef _RTL_TEST_H
+#define _RTL_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RTL_CHECK(expr)                                                      \
+    do {                                                                     \
+        if (!(expr)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            abort();                                                         \
+        }                                                                    \
+    } while (0)
+
+#endif
@@ -0,0 +1,155 @@
+/// @file unordered_map tests (user mode)
+#include "slab.h"
+#include "test/test.h"
+#include "unordered_map.h"
+
+namespace {
+
+size_t g_hash_calls = 0;
+
+struct CountingHash {
+    size_t operator()(int key) const {
+        g_hash_calls++;
+        return rtl::hash<int>()(key);
+    }
+};
+
+// hashes nothing like CountingHash
+struct OtherHash {
+    size_t operator()(int key) const {
+        g_hash_calls++;
+        return ~static_cast<size_t>(key) * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+}  // namespace
+
+namespace rtl {
+template <>
+struct cache_hash_code<int, CountingHash> : true_type {};
+
+template <>
+struct cache_hash_code<int, OtherHash> : true_type {};
+}  // namespace rtl
+
+namespace {
+
+using Map = rtl::unordered_map<int, int, CountingHash>;
+
+void test_node_insert_uses_cached_hash() {
+    Map a, b;
+    for (int i = 0; i < 64; i++) {
+        a.emplace(i, i * 2);
+    }
+    for (int i = 0; i < 64; i++) {
+        auto nh = a.extract(i);
+        RTL_CHECK(!nh.empty());
+        g_hash_calls = 0;
+        auto ret = b.insert(rtl::move(nh));
+        RTL_CHECK(g_hash_calls == 0);
+        RTL_CHECK(ret.inserted);
+        RTL_CHECK(ret.position->second == i * 2);
+    }
+    RTL_CHECK(a.size() == 0);
+    for (int i = 0; i < 64; i++) {
+        RTL_CHECK(b.find(i) != b.end() && b.find(i)->second == i * 2);
+    }
+}
+
+void test_node_insert_after_rekey() {
+    Map a, b;
+    a.emplace(1, 10);
+    auto nh = a.extract(1);
+    nh.key() = 1000;
+    auto ret = b.insert(rtl::move(nh));
+    RTL_CHECK(ret.inserted);
+    RTL_CHECK(b.find(1000) != b.end() && b.find(1000)->second == 10);
+    RTL_CHECK(b.find(1) == b.end());
+}
+
+// same node_type, different hasher: the cached hash must not be reused
+void test_node_insert_across_hashers() {
+    Map a;
+    rtl::unordered_map<int, int, OtherHash> b;
+    for (int i = 0; i < 64; i++) {
+        a.emplace(i, i * 3);
+    }
+    for (int i = 0; i < 64; i++) {
+        auto nh = a.extract(i);
+        g_hash_calls = 0;
+        auto ret = b.insert(rtl::move(nh));
+        RTL_CHECK(g_hash_calls == 1);
+        RTL_CHECK(ret.inserted);
+    }
+    for (int i = 0; i < 64; i++) {
+        RTL_CHECK(b.find(i) != b.end() && b.find(i)->second == i * 3);
+    }
+
+    // and back again
+    for (int i = 0; i < 64; i++) {
+        RTL_CHECK(a.insert(b.extract(i)).inserted);
+    }
+    for (int i = 0; i < 64; i++) {
+        RTL_CHECK(a.find(i) != a.end() && a.find(i)->second == i * 3);
+    }
+}
+
+void test_insert_or_assign_hashes_once() {
+    Map m;
+    for (int i = 0; i < 100; i++) {
+        g_hash_calls = 0;
+        RTL_CHECK(m.insert_or_assign(i, i).second);
+        RTL_CHECK(g_hash_calls == 1);
+    }
+    for (int i = 0; i < 100; i++) {
+        g_hash_calls = 0;
+        auto ret = m.insert_or_assign(i, i + 1);
+        RTL_CHECK(g_hash_calls == 1);
+        RTL_CHECK(!ret.second && ret.first->second == i + 1);
+    }
+    RTL_CHECK(m.size() == 100);
+    for (int i = 0; i < 100; i++) {
+        RTL_CHECK(m.find(i)->second == i + 1);
+    }
+}
+
+void test_max_load_factor() {
+    rtl::unordered_map<int, int> m;
+    RTL_CHECK(m.max_load_factor() == 1.0f);
+
+    m.max_load_factor(0.5f);
+    RTL_CHECK(m.max_load_factor() == 0.5f);
+    for (int i = 0; i < 1000; i++) {
+        m.emplace(i, i);
+        RTL_CHECK(m.size() * 2 <= m.bucket_count());
+    }
+
+    // raising it keeps the buckets, lowering it below the current load rehashes now
+    size_t buckets = m.bucket_count();
+    m.max_load_factor(4.0f);
+    RTL_CHECK(m.max_load_factor() == 4.0f && m.bucket_count() == buckets);
+    m.max_load_factor(0.25f);
+    RTL_CHECK(m.size() * 4 <= m.bucket_count());
+
+    m.max_load_factor(-1.0f);
+    RTL_CHECK(m.max_load_factor() == 1.0f);
+    m.max_load_factor(1e30f);
+    RTL_CHECK(m.max_load_factor() == 65536.0f);
+    for (int i = 0; i < 1000; i++) {
+        RTL_CHECK(m.find(i) != m.end() && m.find(i)->second == i);
+    }
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_node_insert_uses_cached_hash();
+    test_node_insert_after_rekey();
+    test_node_insert_across_hashers();
+    test_insert_or_assign_hashes_once();
+    test_max_load_factor();
+    rtl::slab_uninitialize();
+    printf("unordered_map_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+/// @file vector tests (user mode)
+#include "slab.h"
+#include "test/test.h"
+#include "vector.h"
+
+namespace {
+
+// not trivially relocatable: the object points into itself
+struct Self {
+    int value;
+    Self* self;
+
+    Self(int v) : value(v), self(this) { ; }
+    Self(const Self& other) : value(other.value), self(this) { ; }
+    Self(Self&& other) : value(other.value), self(this) { other.value = -1; }
+    ~Self() { RTL_CHECK(self == this); }
+
+    bool ok() const { return self == this; }
+};
+
+void test_insert_empty_range() {
+    rtl::vector<Self> v;
+    v.emplace_back(1);
+    v.emplace_back(2);
+    Self* e = nullptr;
+    auto it = v.insert(v.begin(), e, e);
+    RTL_CHECK(it == v.begin());
+    RTL_CHECK(v.size() == 2);
+    RTL_CHECK(v[0].ok() && v[0].value == 1);
+    RTL_CHECK(v[1].ok() && v[1].value == 2);
+
+    it = v.insert(v.end(), e, e);
+    RTL_CHECK(it == v.end());
+    RTL_CHECK(v.size() == 2);
+}
+
+void test_insert_range() {
+    rtl::vector<Self> v;
+    v.emplace_back(1);
+    v.emplace_back(4);
+    Self mid[] = {Self(2), Self(3)};
+    v.insert(v.begin() + 1, mid, mid + 2);
+    RTL_CHECK(v.size() == 4);
+    for (size_t i = 0; i < v.size(); i++) {
+        RTL_CHECK(v[i].ok() && v[i].value == int(i) + 1);
+    }
+}
+
+}  // namespace
+
+int main() {
+    rtl::slab_initialize();
+    test_insert_empty_range();
+    test_insert_range();
+    rtl::slab_uninitialize();
+    printf("vector_test: ok\n");
+    return 0;
+}
@@ -1,54 +1,136 @@
-#ifndef _UNORDERED_MAP_H
-#define _UNORDERED_MAP_H
+#ifndef _RTL_UNORDERED_MAP_H
+#define _RTL_UNORDERED_MAP_H
+
+#include <stdint.h>
 
 #include "hash.h"
 #include "list.h"
+#include "simd.h"
 #include "vector.h"
 
 namespace rtl {
 
 //////////////////////////////////////////////////////////////////////////
 //
-// unordered_map
+// cache_hash_code
+//
+// When true, unordered_map keeps the full hash of each key in its node:
+// rehashing never calls the hasher again and chain walks compare hashes
+// before keys. On by default for keys that are not trivially copyable
+// (strings and the like), specialize to change it for a key type.
+//
+template <typename K, typename Hasher>
+struct cache_hash_code : bool_constant<!is_trivially_copyable_v<K>> {};
+
 //
+// Internal element with cached hash
+//
+template <typename T>
+struct __hash_list_val : public __list_val<T> {
+    size_t hash_ = 0;
 
-template <typename K, typename V>
-struct pair {
-    K first = {};
-    V second = {};
+    template <typename... _Valty>
+    __hash_list_val(_Valty&&... val) : __list_val<T>(rtl::forward<_Valty>(val)...) { ; }
+};
 
-    pair() { ; }
-    pair(const K& x, const V& y) : first(x), second(y) { ; }
-    pair(const pair& y) : first(y.first), second(y.second) { ; }
-    ~pair() { ; }
+//
+// one address per hasher type, marks node handles whose cached hash it computed
+//
+template <typename Hasher>
+struct __hasher_tag {
+    static constexpr char id = 0;
 };
 
+//////////////////////////////////////////////////////////////////////////
+//
+// unordered_map
+//
+
 ///
 /// std::unordered_map analog.
 ///
 /// @tparam K - key type.
 /// @tparam V - value type.
+/// @tparam Hasher, KeyEqual - when both declare is_transparent, find, erase
+///                            and contains also take keys of other types.
 /// @tparam Alloc - allocation.
 ///
-template <typename K, typename V, typename Hasher = hash<K>, typename Alloc = allocator<pair<K, V>, PoolTag::Paged>>
+template <typename K, typename V, typename Hasher = hash<K>, typename KeyEqual = equal_to<K>,
+          typename Alloc = allocator<pair<K, V>, PoolTag::Paged>>
 class unordered_map {
    private:
-    using my_list = typename list<pair<K, V>, Alloc>;
+    static constexpr bool kCacheHash = cache_hash_code<K, Hasher>::value;
+
+    using list_node = conditional_t<kCacheHash, __hash_list_val<pair<K, V>>, __list_val<pair<K, V>>>;
+    using my_list = list<pair<K, V>, Alloc, list_node>;
+
+   public:
     using iterator = typename my_list::iterator;
     using const_iterator = typename my_list::const_iterator;
-    using my_vector = typename vector<iterator, allocator<iterator, pool_tag<Alloc>::value>>;
-    using hasher = typename Hasher;
+
+   private:
+    using my_vector = vector<iterator, typename Alloc::template rebind<iterator>::other>;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    // enables the overloads taking any key type Key
+    template <typename Key, typename _Hash = Hasher>
+    using __transparent_key =
+        enable_if_t<__is_transparent_v<_Hash> && __is_transparent_v<KeyEqual> && !is_same_v<Key, iterator> &&
+                    !is_same_v<Key, const_iterator>>;
 
    public:
     using value_type = typename my_list::value_type;
     using size_type = typename my_list::size_type;
+    using allocator_type = Alloc;
+    using node_type = typename my_list::node_type;
+
+    struct insert_return_type {
+        iterator position;
+        bool inserted;
+        node_type node;  // the node back when the key was present
+    };
 
     unordered_map() { init(kMinBuckets); }
 
+    explicit unordered_map(const allocator_type& al) : hash_list_(al), hash_table_(al), old_table_(al) {
+        init(kMinBuckets);
+    }
+
+    /// @brief insert value_type(val...) unless its key is present. A (key, value)
+    /// argument pair is looked up before anything is built, other arguments
+    /// make a temporary value_type that is moved into the node.
     template <typename... _Valty>
     pair<iterator, bool> emplace(_Valty&&... val) {
-        hash_list_.emplace_front(val...);
-        return insert(hash_list_.front(), begin());
+        if constexpr (__is_key_and_value<K, _Valty...>::value) {
+            return try_emplace(rtl::forward<_Valty>(val)...);
+        } else {
+            value_type tmp(rtl::forward<_Valty>(val)...);
+            return try_emplace(rtl::move(tmp.first), rtl::move(tmp.second));
+        }
+    }
+
+    /// @brief insert (key, V(val...)) unless key is present; on a hit nothing is
+    /// allocated, built or copied
+    template <typename... _Valty>
+    pair<iterator, bool> try_emplace(const K& key, _Valty&&... val) {
+        return emplace_key(key, rtl::forward<_Valty>(val)...);
+    }
+
+    template <typename... _Valty>
+    pair<iterator, bool> try_emplace(K&& key, _Valty&&... val) {
+        return emplace_key(rtl::move(key), rtl::forward<_Valty>(val)...);
+    }
+
+    /// @brief assign obj to the value of key, inserting it if not present
+    template <typename Obj>
+    pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj) {
+        return assign_key(key, rtl::forward<Obj>(obj));
+    }
+
+    template <typename Obj>
+    pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj) {
+        return assign_key(rtl::move(key), rtl::forward<Obj>(obj));
     }
 
     iterator begin() { return hash_list_.begin(); }
@@ -59,60 +141,321 @@ class unordered_map {
 
     const_iterator end() const { return hash_list_.end(); }
 
-    iterator find(const K& key) { return find<iterator>(key); }
+    iterator find(const K& key) { return find_key(key); }
 
-    const_iterator find(const K& key) const { return find<const_iterator>(key); }
+    const_iterator find(const K& key) const { return find_key(key); }
 
-    size_type erase(const K& key) {
-        auto it = find(key);
-        if (it != end()) {
-            erase(it);
-            return 1;
+    template <typename Key, typename = __transparent_key<Key>>
+    iterator find(const Key& key) {
+        return find_key(key);
+    }
+
+    template <typename Key, typename = __transparent_key<Key>>
+    const_iterator find(const Key& key) const {
+        return find_key(key);
+    }
+
+    bool contains(const K& key) const { return find_key(key) != end(); }
+
+    /// @brief find keys[0, n) into out[0, n) (end() when missing). Keys are
+    /// handled kBatch at a time: all of them are hashed and their buckets
+    /// prefetched, then the first node of each bucket, and only then are the
+    /// chains walked, so the cache misses of different keys overlap.
+    void find_batch(const K* keys, size_type n, iterator* out) {
+        size_type hashes[kBatch];
+        for (size_type first = 0; first < n; first += kBatch) {
+            size_type count = n - first < kBatch ? n - first : kBatch;
+            for (size_type i = 0; i < count; i++) {
+                hashes[i] = hasher()(keys[first + i]);
+                size_type bucket;
+                my_vector& table = locate(hashes[i], bucket);
+                prefetch(&table[bucket * 2]);
+            }
+            for (size_type i = 0; i < count; i++) {
+                size_type bucket;
+                my_vector& table = locate(hashes[i], bucket);
+                prefetch(begin(table, bucket).ptr_);
+            }
+            for (size_type i = 0; i < count; i++) {
+                size_type bucket;
+                my_vector& table = locate(hashes[i], bucket);
+                out[first + i] = find_in(table, bucket, keys[first + i], hashes[i]);
+            }
         }
-        return 0;
     }
 
-    const_iterator erase(const_iterator it) { return erase<const_iterator>(it); }
+    /// @brief insert vals[0, n) like insert, hashing and prefetching the
+    /// buckets of kBatch values before inserting them
+    /// @return number of values inserted (keys not already present)
+    size_type insert_batch(const value_type* vals, size_type n) {
+        reserve(size() + n);
+
+        size_type hashes[kBatch];
+        size_type inserted = 0;
+        for (size_type first = 0; first < n; first += kBatch) {
+            size_type count = n - first < kBatch ? n - first : kBatch;
+            for (size_type i = 0; i < count; i++) {
+                hashes[i] = hasher()(vals[first + i].first);
+                size_type bucket;
+                my_vector& table = locate(hashes[i], bucket);
+                prefetch(&table[bucket * 2]);
+            }
+            for (size_type i = 0; i < count; i++) {
+                const value_type& val = vals[first + i];
+                inserted += emplace_hashed(hashes[i], val.first, val.second).second;
+            }
+        }
+        return inserted;
+    }
+
+    template <typename Key, typename = __transparent_key<Key>>
+    bool contains(const Key& key) const {
+        return find_key(key) != end();
+    }
+
+    size_type erase(const K& key) { return erase_key(key); }
+
+    template <typename Key, typename = __transparent_key<Key>>
+    size_type erase(const Key& key) {
+        return erase_key(key);
+    }
+
+    const_iterator erase(const_iterator it) {
+        iterator next = erase((iterator&)it);
+        return (const_iterator&)next;
+    }
+
+    iterator erase(iterator it) {
+        migrate(migrate_step_);
+        size_type bucket;
+        my_vector& table = locate(hash_of(it), bucket);
+        remove_bucket(table, it, bucket);
+        return hash_list_.erase(it);
+    }
+
+    /// @brief unlink the element at it, handing its node to the caller
+    node_type extract(const_iterator it) {
+        migrate(migrate_step_);
+        iterator where(const_cast<typename iterator::pointer>(it.ptr_));
+        size_type bucket;
+        my_vector& table = locate(hash_of(where), bucket);
+        remove_bucket(table, where, bucket);
+        node_type nh = hash_list_.extract(where);
+        if constexpr (kCacheHash) {
+            nh.__set_hash_tag(&__hasher_tag<Hasher>::id);
+        }
+        return nh;
+    }
 
-    iterator erase(iterator it) { return erase<iterator>(it); }
+    node_type extract(const K& key) {
+        iterator it = find(key);
+        return it != end() ? extract(const_iterator(it.ptr_)) : node_type();
+    }
 
-    V& operator[](K& key) { return try_emplace(key).first->second; }
+    /// @brief insert the node of nh unless its key is present, without allocating
+    insert_return_type insert(node_type&& nh) {
+        if (nh.empty()) {
+            return insert_return_type{end(), false, node_type()};
+        }
+
+        migrate(migrate_step_);
+        const K& key = static_cast<const node_type&>(nh).key();
+        size_type h;
+        if constexpr (kCacheHash) {
+            // the node carries the hash it was linked with; it is ours only when it
+            // came from a map with the same hasher and the key was not rewritten
+            h = nh.hash_tag() == &__hasher_tag<Hasher>::id ? static_cast<list_node*>(nh.__node())->hash_
+                                                            : hasher()(key);
+        } else {
+            h = hasher()(key);
+        }
+        size_type bucket;
+        my_vector& table = locate(h, bucket);
+        iterator where = find_in(table, bucket, key, h);
+        if (where != end()) {
+            return insert_return_type{where, false, rtl::move(nh)};
+        }
+
+        where = begin(table, bucket);
+        iterator node = hash_list_.insert(where, rtl::move(nh));
+        link_node(table, bucket, node, where, h);
+        return insert_return_type{node, true, node_type()};
+    }
+
+    /// @brief keep up to limit erased nodes for reuse by later insertions (default 0)
+    void set_node_cache_limit(size_type limit) { hash_list_.set_node_cache_limit(limit); }
 
     V& operator[](const K& key) { return try_emplace(key).first->second; }
 
+    V& operator[](K&& key) { return try_emplace(rtl::move(key)).first->second; }
+
+    /// @brief destroy all elements, keeping the bucket count
     void clear() {
         hash_list_.clear();
-        init(kMinBuckets);
+        release_old_table();
+        init(buckets_);
     }
 
+    _NODISCARD bool empty() const { return hash_list_.empty(); }
+
+    size_type size() const { return hash_list_.size(); }
+
+    //
+    // buckets
+    //
+    // While an incremental rehash is in progress (see migrate), buckets
+    // refer to the new array and do not count elements not yet moved.
+    //
     size_type bucket_count() const { return buckets_; }
 
+    size_type bucket(const K& key) const { return hasher()(key) & mask_; }
+
+    size_type bucket_size(size_type n) const {
+        const_iterator it = (const_iterator&)hash_table_[n * 2];
+        if (it == end()) {
+            return 0;
+        }
+
+        size_type count = 1;
+        for (const_iterator last = (const_iterator&)hash_table_[n * 2 + 1]; it != last; ++it) {
+            count++;
+        }
+        return count;
+    }
+
+    float load_factor() const { return static_cast<float>(size()) / static_cast<float>(buckets_); }
+
+    float max_load_factor() const { return static_cast<float>(max_load_) / kLoadOne; }
+
+    /// @brief grow once size() exceeds ml * bucket_count(), rehashing now if it already does.
+    /// ml is kept in 1/kLoadOne steps, so growth itself never touches the FPU.
+    void max_load_factor(float ml) {
+        if (!(ml > 0)) {
+            max_load_ = kLoadOne;
+        } else if (ml >= kMaxLoad / kLoadOne) {
+            max_load_ = kMaxLoad;
+        } else {
+            size_type load = static_cast<size_type>(ml * kLoadOne + 0.5f);
+            max_load_ = load ? load : 1;
+        }
+        max_size_ = max_size_for(buckets_);
+        if (size() > max_size_) {
+            rehash(0);
+        }
+    }
+
+    /// @brief rebuild with at least n buckets (and enough for size()), now
+    void rehash(size_type n) {
+        size_type buckets = buckets_for(size());
+        while (buckets < n && buckets < SIZE_MAX / 2) {
+            buckets *= 2;
+        }
+        if (buckets != buckets_) {
+            start_rehash(buckets);
+            migrate(old_buckets_);
+        }
+    }
+
+    /// @brief make room for n elements without rehashing
+    void reserve(size_type n) {
+        if (n > max_size_) {
+            rehash(buckets_for(n));
+        }
+    }
+
+    allocator_type get_allocator() const { return hash_list_.get_allocator(); }
+
    private:
-    template <typename Iterator>
-    Iterator find(const K& key) {
-        size_type bucket = hash(key);
-        for (Iterator it = begin(bucket); it != end(bucket); ++it) {
-            if (it->first == key) {
+    template <typename Key>
+    iterator find_key(const Key& key) {
+        size_type h = hasher()(key);
+        size_type bucket;
+        my_vector& table = locate(h, bucket);
+        return find_in(table, bucket, key, h);
+    }
+
+    template <typename Key>
+    const_iterator find_key(const Key& key) const {
+        iterator it = const_cast<unordered_map*>(this)->find_key(key);
+        return (const_iterator&)it;
+    }
+
+    template <typename Key>
+    iterator find_in(my_vector& table, size_type bucket, const Key& key, size_type h) {
+        for (iterator it = begin(table, bucket); it != end(table, bucket); ++it) {
+            if (hash_matches(it, h) && key_equal()(it->first, key)) {
                 return it;
             }
         }
         return end();
     }
 
-    template <typename Iterator>
-    Iterator erase(Iterator& it) {
-        size_type bucket = hash(it->first);
-        remove_bucket(it, bucket);
-        return hash_list_.erase(it);
+    template <typename Key>
+    size_type erase_key(const Key& key) {
+        iterator it = find_key(key);
+        if (it != end()) {
+            erase(it);
+            return 1;
+        }
+        return 0;
     }
 
-    template <typename Key>
-    pair<iterator, bool> try_emplace(Key&& key) {
-        iterator where = find(key);
-        if (where == end()) {
-            return emplace(value_type(key, {}));
+    template <typename Key, typename... _Valty>
+    pair<iterator, bool> emplace_key(Key&& key, _Valty&&... val) {
+        size_type h = hasher()(key);
+        return emplace_hashed(h, rtl::forward<Key>(key), rtl::forward<_Valty>(val)...);
+    }
+
+    /// @brief emplace_key for a key whose hash h is already known
+    template <typename Key, typename... _Valty>
+    pair<iterator, bool> emplace_hashed(size_type h, Key&& key, _Valty&&... val) {
+        migrate(migrate_step_);
+
+        size_type bucket;
+        my_vector& table = locate(h, bucket);
+        iterator where = find_in(table, bucket, key, h);
+        if (where != end()) {
+            return pair<iterator, bool>(where, false);
+        }
+        return pair<iterator, bool>(emplace_new(table, bucket, h, rtl::forward<Key>(key), rtl::forward<_Valty>(val)...),
+                                    true);
+    }
+
+    /// @brief build a node for a key known to be missing from bucket (hash h)
+    template <typename Key, typename... _Valty>
+    iterator emplace_new(my_vector& table, size_type bucket, size_type h, Key&& key, _Valty&&... val) {
+        // new nodes go to the front of their bucket, or to the tail of the list
+        iterator where = begin(table, bucket);
+        iterator node =
+            hash_list_.emplace(where, __pair_emplace_t(), rtl::forward<Key>(key), rtl::forward<_Valty>(val)...);
+        link_node(table, bucket, node, where, h);
+        return node;
+    }
+
+    /// @brief account for node (hash h), just put into the list before where
+    void link_node(my_vector& table, size_type bucket, iterator node, iterator where, size_type h) {
+        if constexpr (kCacheHash) {
+            static_cast<list_node*>(node.ptr_)->hash_ = h;
         }
-        return pair<iterator, bool>(where, false);
+
+        insert_bucket(table, node, where, bucket);
+        desired_grow_bucket_count();
+    }
+
+    template <typename Key, typename Obj>
+    pair<iterator, bool> assign_key(Key&& key, Obj&& obj) {
+        size_type h = hasher()(key);
+        migrate(migrate_step_);
+
+        size_type bucket;
+        my_vector& table = locate(h, bucket);
+        iterator where = find_in(table, bucket, key, h);
+        if (where != end()) {
+            where->second = rtl::forward<Obj>(obj);
+            return pair<iterator, bool>(where, false);
+        }
+        return pair<iterator, bool>(emplace_new(table, bucket, h, rtl::forward<Key>(key), rtl::forward<Obj>(obj)),
+                                    true);
     }
 
     void init(size_type buckets) {
@@ -121,112 +464,191 @@ class unordered_map {
         hash_table_.assign(buckets * 2, hash_list_.end());
         buckets_ = buckets;
         mask_ = buckets - 1;
+        max_size_ = max_size_for(buckets);
     }
 
-    iterator begin(size_type bucket) { return hash_table_[bucket * 2]; }
-    const_iterator begin(size_type bucket) const { return (const_iterator&)hash_table_[bucket * 2]; }
+    /// @brief most elements allowed in buckets before growing
+    size_type max_size_for(size_type buckets) const {
+        if (buckets > (SIZE_MAX / 2) / max_load_) {
+            return SIZE_MAX / 2;
+        }
+        return buckets * max_load_ / kLoadOne;
+    }
 
-    iterator end(size_type bucket) {
-        if (hash_table_[bucket * 2] == hash_list_.end()) {
-            return hash_list_.end();
-        } else {
-            iterator end = hash_table_[bucket * 2 + 1];
-            return (++end);
+    /// @brief fewest buckets (a power of 2) holding n elements
+    size_type buckets_for(size_type n) const {
+        size_type buckets = kMinBuckets;
+        while (max_size_for(buckets) < n && buckets < SIZE_MAX / 2) {
+            buckets *= 2;
+        }
+        return buckets;
+    }
+
+    //
+    // Growing the table does not rehash every node at once: the previous
+    // bucket array is kept as old_table_ and each mutating operation moves
+    // up to migrate_step_ of its buckets into hash_table_. Buckets below
+    // migrate_pos_ have been moved; a key whose old bucket is still pending
+    // is looked up and inserted in old_table_.
+    //
+    bool migrating() const { return migrate_pos_ < old_buckets_; }
+
+    /// @brief table and bucket currently holding keys with hash h
+    my_vector& locate(size_type h, size_type& bucket) {
+        if (migrating() && (h & old_mask_) >= migrate_pos_) {
+            bucket = h & old_mask_;
+            return old_table_;
         }
+        bucket = h & mask_;
+        return hash_table_;
     }
 
-    const_iterator end(size_type bucket) const {
-        if (hash_table_[bucket * 2] == hash_list_.end()) {
+    iterator begin(my_vector& table, size_type bucket) { return table[bucket * 2]; }
+
+    iterator end(my_vector& table, size_type bucket) {
+        if (table[bucket * 2] == hash_list_.end()) {
             return hash_list_.end();
         } else {
-            const_iterator end =
-                (const_iterator&)hash_table_[bucket * 2 + 1];
+            iterator end = table[bucket * 2 + 1];
             return (++end);
         }
     }
 
-    void reinsert() {
-        iterator last = end();
-        if (last != begin()) {
-            for (--last;;) {
-                iterator cur = begin();
-                bool done = cur == last;
-                insert(*cur, cur);
-                if (done) break;
+    /// @brief switch to a new array of buckets, moving the nodes over incrementally
+    void start_rehash(size_type buckets) {
+        // the previous rehash is normally done long before, see migrate_step_
+        migrate(old_buckets_);
+
+        old_table_.swap(hash_table_);
+        old_mask_ = mask_;
+        old_buckets_ = buckets_;
+        migrate_pos_ = 0;
+        init(buckets);
+
+        // finish within the inserts left before the next growth
+        size_type inserts = max_size_ > size() ? max_size_ - size() : 1;
+        migrate_step_ = old_buckets_ / inserts + 1;
+        if (migrate_step_ < kMigrateBuckets) {
+            migrate_step_ = kMigrateBuckets;
+        }
+    }
+
+    /// @brief move up to count buckets of old_table_ into hash_table_
+    void migrate(size_type count) {
+        for (; count && migrating(); count--) {
+            size_type bucket = migrate_pos_++;
+            iterator first = old_table_[bucket * 2];
+            if (first == hash_list_.end()) {
+                continue;
+            }
+
+            iterator last = old_table_[bucket * 2 + 1];
+            old_table_[bucket * 2] = hash_list_.end();
+            old_table_[bucket * 2 + 1] = hash_list_.end();
+            for (bool done = false; !done;) {
+                iterator node = first++;
+                done = node == last;
+                size_type to = hash_of(node) & mask_;
+                iterator where = begin(hash_table_, to);
+                iterator next = node;
+                if (where != ++next) {
+                    hash_list_.splice(where, hash_list_, node, next);
+                }
+                insert_bucket(hash_table_, node, where, to);
             }
         }
+
+        if (old_buckets_ && !migrating()) {
+            release_old_table();
+        }
     }
 
-    size_type hash(const K& key) const { return hasher()(key) & mask_; }
+    void release_old_table() {
+        old_table_.clear();
+        old_table_.shrink_to_fit();
+        old_buckets_ = 0;
+        migrate_pos_ = 0;
+    }
 
-    void insert_bucket(iterator data, iterator where, size_type bucket) {
-        if (hash_table_[bucket * 2] == hash_list_.end()) {
-            hash_table_[bucket * 2] = data;
-            hash_table_[bucket * 2 + 1] = data;
-        } else if (hash_table_[bucket * 2] == where) {
-            hash_table_[bucket * 2] = data;
+    void insert_bucket(my_vector& table, iterator data, iterator where, size_type bucket) {
+        if (table[bucket * 2] == hash_list_.end()) {
+            table[bucket * 2] = data;
+            table[bucket * 2 + 1] = data;
+        } else if (table[bucket * 2] == where) {
+            table[bucket * 2] = data;
         } else {
             ;  // condition
         }
     }
 
-    void remove_bucket(iterator where, size_type bucket) {
-        if (hash_table_[bucket * 2] == where) {
-            if (hash_table_[bucket * 2 + 1] == where) {
-                hash_table_[bucket * 2] = hash_list_.end();
-                hash_table_[bucket * 2 + 1] = hash_list_.end();
+    void remove_bucket(my_vector& table, iterator where, size_type bucket) {
+        if (table[bucket * 2] == where) {
+            if (table[bucket * 2 + 1] == where) {
+                table[bucket * 2] = hash_list_.end();
+                table[bucket * 2 + 1] = hash_list_.end();
             } else {
-                hash_table_[bucket * 2] = ++where;
+                table[bucket * 2] = ++where;
             }
         } else {
-            if (hash_table_[bucket * 2 + 1] == where) {
-                hash_table_[bucket * 2 + 1] = --where;
+            if (table[bucket * 2 + 1] == where) {
+                table[bucket * 2 + 1] = --where;
             }
         }
     }
 
-    pair<iterator, bool> insert(value_type& val, iterator node) {
-        size_type bucket = hash(val.first);
-        iterator where = end(bucket);
-        while (where != begin(bucket)) {
-            if ((--where)->first == val.first) {
-                hash_list_.erase(node);
-                return pair<iterator, bool>(where, false);
-            }
+    /// @brief full hash of the key in node
+    size_type hash_of(iterator node) const {
+        if constexpr (kCacheHash) {
+            return static_cast<list_node*>(node.ptr_)->hash_;
+        } else {
+            return hasher()(node->first);
         }
+    }
 
-        iterator next = node;
-        if (where != ++next) {
-            hash_list_.splice(where, hash_list_, node, next);
+    /// @brief false if node can not hold a key with hash h (without comparing keys)
+    bool hash_matches(iterator node, size_type h) const {
+        if constexpr (kCacheHash) {
+            return static_cast<list_node*>(node.ptr_)->hash_ == h;
+        } else {
+            return true;
         }
-
-        insert_bucket(node, where, bucket);
-        desired_grow_bucket_count();
-        return pair<iterator, bool>(node, true);
     }
 
     void desired_grow_bucket_count() {
-        if (max_bucket_size_ * bucket_count() < hash_list_.size()) {
+        if (max_size_ < hash_list_.size()) {
             size_t buckets = bucket_count();
             if (buckets < 512)
                 buckets *= 8;  // multiply by 8
             else if (buckets < SIZE_MAX / 2)
                 buckets *= 2;  // multiply safely by 2
 
-            init(buckets);
-            reinsert();
+            start_rehash(buckets);
         }
     }
 
    private:
     static constexpr size_type kMinBuckets = 8;  // must be a positive power of 2
 
+    // fewest buckets moved per operation during an incremental rehash
+    static constexpr size_type kMigrateBuckets = 4;
+    static constexpr size_type kBatch = 16;  // keys in flight in find_batch/insert_batch
+
+    static constexpr size_type kLoadOne = 256;               // max_load_ of a load factor of 1
+    static constexpr size_type kMaxLoad = kLoadOne * 65536;  // highest max_load_
+
     my_list hash_list_;
     my_vector hash_table_;
     size_type mask_;
     size_type buckets_;
 
-    size_type max_bucket_size_ = 1;
+    my_vector old_table_;  // buckets still to be moved into hash_table_
+    size_type old_mask_ = 0;
+    size_type old_buckets_ = 0;
+    size_type migrate_pos_ = 0;
+    size_type migrate_step_ = kMigrateBuckets;
+
+    size_type max_load_ = kLoadOne;  // max_load_factor() in 1/kLoadOne
+    size_type max_size_ = 0;         // max_load_ * buckets_ / kLoadOne, checked on every insert
 };
 
 }  // namespace rtl
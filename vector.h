@@ -8,34 +8,113 @@
 
 namespace rtl {
 
-template <class T, class Alloc = allocator<T>>
-class vector {
+//
+// Allocator plus room for N elements kept inside the container itself
+// (small_vector); N == 0 adds nothing to the allocator holder.
+//
+template <class T, class Alloc, size_t N>
+class __vector_storage : public __alloc_holder<Alloc> {
+   public:
+    __vector_storage() = default;
+    __vector_storage(const Alloc& al) : __alloc_holder<Alloc>(al) { ; }
+
+    T* small_data() { return reinterpret_cast<T*>(small_); }
+
+   private:
+    alignas(T) unsigned char small_[N * sizeof(T)];
+};
+
+template <class T, class Alloc>
+class __vector_storage<T, Alloc, 0> : public __alloc_holder<Alloc> {
+   public:
+    __vector_storage() = default;
+    __vector_storage(const Alloc& al) : __alloc_holder<Alloc>(al) { ; }
+
+    T* small_data() { return nullptr; }
+};
+
+//
+// Implementation shared by vector (N == 0) and small_vector (N inline
+// elements, used before the first heap allocation).
+//
+template <class T, class Alloc, size_t N>
+class __vector_impl : private __vector_storage<T, Alloc, N> {
    public:
     using iterator = T*;
     using const_iterator = const T*;
     using allocator_type = Alloc;
 
    public:
-    vector() = default;
+    __vector_impl() = default;
+
+    explicit __vector_impl(const allocator_type& al) : __vector_storage<T, Alloc, N>(al) { ; }
+
+    __vector_impl(const __vector_impl& other) : __vector_storage<T, Alloc, N>(other.get_al()) {
+        append(other.begin(), other.end());
+    }
+
+    __vector_impl(__vector_impl&& other) noexcept : __vector_storage<T, Alloc, N>(other.get_al()) {
+        take(other);
+    }
 
-    ~vector() {
+    ~__vector_impl() {
         clear();
-        if (start_) {
-            allocator_type().deallocate(start_, 0);
-            start_ = nullptr;
+        replace_buffer(nullptr, 0, 0);
+    }
+
+    __vector_impl& operator=(const __vector_impl& other) {
+        if (this != &other) {
+            clear();
+            append(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    __vector_impl& operator=(__vector_impl&& other) noexcept {
+        if (this != &other) {
+            clear();
+            replace_buffer(this->small_data(), 0, N);
+            this->get_al() = other.get_al();
+            take(other);
         }
+        return *this;
     }
 
-    vector(const vector&) = delete;             // TODO
-    vector& operator=(const vector&) = delete;  // TODO
+    void swap(__vector_impl& other) noexcept {
+        if (is_small() || other.is_small()) {
+            __vector_impl tmp(rtl::move(other));
+            other = rtl::move(*this);
+            *this = rtl::move(tmp);
+            return;
+        }
+
+        allocator_type al = this->get_al();
+        this->get_al() = other.get_al();
+        other.get_al() = al;
+
+        iterator tmp[3] = {start_, end_, last_};
+        start_ = other.start_;
+        end_ = other.end_;
+        last_ = other.last_;
+        other.start_ = tmp[0];
+        other.end_ = tmp[1];
+        other.last_ = tmp[2];
+    }
 
     /// @brief destructor all elems
     void clear() {
+        if (is_trivially_destructible_v<T>) {
+            end_ = start_;
+        }
         while (start_ < end_) {
             (--end_)->~T();
         }
     }
 
+    _NODISCARD allocator_type get_allocator() const {
+        return this->get_al();
+    }
+
     _NODISCARD bool empty() const {
         return size() == 0;
     }
@@ -48,6 +127,30 @@ class vector {
         return start_[pos];
     }
 
+    _NODISCARD T* data() {
+        return start_;
+    }
+
+    _NODISCARD const T* data() const {
+        return start_;
+    }
+
+    T& front() {
+        return *start_;
+    }
+
+    const T& front() const {
+        return *start_;
+    }
+
+    T& back() {
+        return end_[-1];
+    }
+
+    const T& back() const {
+        return end_[-1];
+    }
+
     _NODISCARD iterator begin() {
         return start_;
     }
@@ -75,14 +178,20 @@ class vector {
     void reserve(size_t n) {
         if (n > capacity()) {
             size_t pos = size();
-            allocator_type al;
-            T* tmp = al.allocate(n);
-            assert(tmp);
-            memmove(tmp, start_, pos * sizeof(T));
-            al.deallocate(start_, pos);
-            start_ = tmp;
-            end_ = tmp + pos;
-            last_ = tmp + n;
+            T* tmp = allocate_buffer(n);
+            __relocate(start_, end_, tmp);
+            replace_buffer(tmp, pos, n);
+        }
+    }
+
+    /// @brief drop unused capacity (frees the buffer when the elements fit inline)
+    void shrink_to_fit() {
+        if (end_ != last_ && !is_small()) {
+            size_t pos = size();
+            size_t cap = pos > N ? pos : N;
+            T* tmp = pos > N ? allocate_buffer(pos) : this->small_data();
+            __relocate(start_, end_, tmp);
+            replace_buffer(tmp, pos, cap);
         }
     }
 
@@ -101,26 +210,208 @@ class vector {
         }
     }
 
+    /// @brief resize without value-initializing new elements, for buffers the
+    /// caller fills right away (trivial types are left indeterminate)
+    void resize_for_overwrite(size_t n) {
+        if (n < size()) {
+            __destroy(start_ + n, end_);
+            end_ = start_ + n;
+            return;
+        }
+
+        reserve(n);
+        while (end_ < start_ + n) {
+            new (end_) T;
+            end_++;
+        }
+    }
+
     void assign(size_t n, const T& val) {
-        end_ = start_;
+        clear();
         resize(n, val);
     }
 
+    template <typename Iter>
+    void assign(Iter first, Iter last) {
+        clear();
+        append(first, last);
+    }
+
+    void push_back(const T& val) {
+        emplace_back(val);
+    }
+
+    void push_back(T&& val) {
+        emplace_back(rtl::move(val));
+    }
+
     template <typename... _Valty>
-    void emplace_back(_Valty&&... val) {
+    T& emplace_back(_Valty&&... val) {
         if (end_ == last_) {
-            reserve(capacity() == 0 ? 4 : capacity() * 2);
+            return emplace_back_reallocate(rtl::forward<_Valty>(val)...);
+        }
+        new (end_) T(rtl::forward<_Valty>(val)...);
+        return *end_++;
+    }
+
+    void pop_back() {
+        (--end_)->~T();
+    }
+
+    /// @brief append [first, last) (not from this vector) growing at most once
+    template <typename Iter>
+    void append(Iter first, Iter last) {
+        size_t n = __distance(first, last);
+        if (n > size_t(last_ - end_)) {
+            reserve(grow_capacity(size() + n));
+        }
+        end_ = __uninitialized_copy(first, last, end_);
+    }
+
+    /// @brief insert [first, last) (not from this vector) before pos with a
+    /// single shift of the tail, reallocating at most once
+    template <typename Iter>
+    iterator insert(const_iterator pos, Iter first, Iter last) {
+        size_t off = pos - start_;
+        size_t n = __distance(first, last);
+        if (n == 0) {
+            return start_ + off;
+        }
+        open_gap(off, n);
+        __uninitialized_copy(first, last, start_ + off);
+        return start_ + off;
+    }
+
+    iterator insert(const_iterator pos, const T& val) {
+        return emplace(pos, val);
+    }
+
+    iterator insert(const_iterator pos, T&& val) {
+        return emplace(pos, rtl::move(val));
+    }
+
+    template <typename... _Valty>
+    iterator emplace(const_iterator pos, _Valty&&... val) {
+        size_t off = pos - start_;
+        if (start_ + off == end_) {
+            emplace_back(rtl::forward<_Valty>(val)...);
+        } else {
+            T tmp(rtl::forward<_Valty>(val)...);  // val may refer into this vector
+            open_gap(off, 1);
+            new (start_ + off) T(rtl::move(tmp));
+        }
+        return start_ + off;
+    }
+
+    iterator erase(const_iterator pos) {
+        return erase(pos, pos + 1);
+    }
+
+    /// @brief remove [first, last) with a single shift of the tail
+    iterator erase(const_iterator first, const_iterator last) {
+        iterator where = start_ + (first - start_);
+        if (first != last) {
+            size_t n = last - first;
+            __destroy(where, where + n);
+            __relocate(where + n, end_, where);
+            end_ -= n;
         }
-        new (end_) T(val...);
-        end_++;
+        return where;
     }
 
    private:
-    iterator start_ = nullptr;
-    iterator end_ = nullptr;
-    iterator last_ = nullptr;
+    /// @brief elements are inline (or, for N == 0, there is no buffer yet)
+    bool is_small() {
+        return start_ == this->small_data();
+    }
+
+    /// @brief move the contents of other into this empty container
+    void take(__vector_impl& other) {
+        if (other.is_small()) {
+            if constexpr (N > 0) {  // else there are no elements to move
+                __relocate(other.start_, other.end_, start_);
+                end_ = start_ + other.size();
+                other.end_ = other.start_;
+            }
+        } else {
+            start_ = other.start_;
+            end_ = other.end_;
+            last_ = other.last_;
+            other.start_ = other.small_data();
+            other.end_ = other.start_;
+            other.last_ = other.start_ + N;
+        }
+    }
+
+    size_t grow_capacity(size_t n) const {
+        size_t grow = capacity() == 0 ? 4 : capacity() * 2;
+        return grow > n ? grow : n;
+    }
+
+    /// @brief make room for n (> 0) uninitialized elements at off
+    void open_gap(size_t off, size_t n) {
+        _RTL_ASSERT(n > 0);
+        if (n > size_t(last_ - end_)) {
+            size_t pos = size();
+            size_t cap = grow_capacity(pos + n);
+            T* tmp = allocate_buffer(cap);
+            __relocate(start_, start_ + off, tmp);
+            __relocate(start_ + off, end_, tmp + off + n);
+            replace_buffer(tmp, pos + n, cap);
+        } else {
+            __relocate_backward(start_ + off, end_, start_ + off + n);
+            end_ += n;
+        }
+    }
+
+    T* allocate_buffer(size_t n) {
+        T* p = this->get_al().allocate(n);
+        assert(p);
+        _RTL_TRACK_CONTAINER(vector, 1, n * sizeof(T));
+        return p;
+    }
+
+    /// @brief free the current buffer and adopt p, holding size of n elements
+    void replace_buffer(T* p, size_t size, size_t n) {
+        if (!is_small()) {
+            _RTL_TRACK_CONTAINER(vector, -1, capacity() * sizeof(T));
+            this->get_al().deallocate(start_, capacity());
+        }
+        start_ = p;
+        end_ = p + size;
+        last_ = p + n;
+    }
+
+    template <typename... _Valty>
+    T& emplace_back_reallocate(_Valty&&... val) {
+        size_t pos = size();
+        size_t n = grow_capacity(pos + 1);
+        T* tmp = allocate_buffer(n);
+
+        // construct first, val may refer to an element of the old buffer
+        new (tmp + pos) T(rtl::forward<_Valty>(val)...);
+        __relocate(start_, end_, tmp);
+        replace_buffer(tmp, pos + 1, n);
+        return tmp[pos];
+    }
+
+    iterator start_ = this->small_data();
+    iterator end_ = start_;
+    iterator last_ = start_ + N;
 };
 
+template <class T, class Alloc = allocator<T>>
+class vector : public __vector_impl<T, Alloc, 0> {
+   public:
+    using __vector_impl<T, Alloc, 0>::__vector_impl;
+
+    vector() = default;
+};
+
+// the elements live in a separate buffer, so the vector itself can be moved bitwise
+template <class T, class Alloc>
+struct is_trivially_relocatable<vector<T, Alloc>> : is_trivially_relocatable<Alloc> {};
+
 }  // namespace rtl
 
-#endif
+#endif
\ No newline at end of file